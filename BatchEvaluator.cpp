@@ -0,0 +1,239 @@
+#include <string.h>
+#include "BatchEvaluator.h"
+#include "Trace.h"
+
+using namespace std;
+
+
+/**
+ * Constructor
+ */
+BatchEvaluator::BatchEvaluator(short _dim, int _capacity)
+{
+  dimSize = _dim;
+  capacity = _capacity;
+  size = 0;
+
+  stride = (capacity + BLOCK_SIZE-1)/BLOCK_SIZE*BLOCK_SIZE;
+  cells = new int8_t[dimSize*dimSize*stride];
+  memset(cells, 0, dimSize*dimSize*stride);
+
+  SetEvalParams(EvalParams());
+
+  for (int b=0; b<BLOCK_SIZE; b++)
+    lineEnd[b] = WALL;
+
+  // rows, columns and both diagonals, leaving out the lines too short to hold five,
+  // where assessBoard scores nothing and no one can win
+  const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+  for (short d=0; d<4; d++){
+    short dirRow = DIRECTIONS[d][0], dirCol = DIRECTIONS[d][1];
+    for (short row=0; row<dimSize; row++){
+      for (short col=0; col<dimSize; col++){
+        // a line starts where the previous cell is off the board
+        short prevRow = row-dirRow, prevCol = col-dirCol;
+        if (prevRow >= 0 && prevRow < dimSize && prevCol >= 0 && prevCol < dimSize)
+          continue;
+
+        size_t start = lineCells.size();
+        for (short i=row, j=col; i>=0 && i<dimSize && j>=0 && j<dimSize; i+=dirRow, j+=dirCol)
+          lineCells.push_back(i*dimSize+j);
+
+        if (lineCells.size()-start < 5)
+          lineCells.resize(start);
+        else
+          lineStarts.push_back((int)start);
+      }
+    }
+  }
+  lineStarts.push_back((int)lineCells.size());
+}
+
+
+/**
+ * Destructor
+ */
+BatchEvaluator::~BatchEvaluator()
+{
+  delete [] cells;
+}
+
+
+void BatchEvaluator::SetEvalParams(const EvalParams& _params){
+  EvalParams params = _params;
+  for (short k=0; k<EvalParams::NUM_PARAMS; k++)
+    weights[k] = params.Get(k);
+}
+
+
+/**
+ * Append a position, see header
+ */
+int BatchEvaluator::Add(const char* cells){
+  int numCells = dimSize*dimSize;
+  if (size >= capacity)
+    return -1;
+
+  for (int ind=0; ind<numCells; ind++){
+    if (cells[ind] != '.' && cells[ind] != HUMAN_COLOR && cells[ind] != AI_COLOR)
+      return -1;
+  }
+  if (cells[numCells] != '\0')
+    return -1;
+
+  for (int ind=0; ind<numCells; ind++){
+    int8_t code = 0;
+    if (cells[ind] == HUMAN_COLOR)
+      code = HUMAN_FIVE;
+    else if (cells[ind] == AI_COLOR)
+      code = AI_FIVE;
+    this->cells[ind*stride + size] = code;
+  }
+
+  return size++;
+}
+
+
+void BatchEvaluator::Clear(){
+  memset(cells, 0, dimSize*dimSize*stride);
+  size = 0;
+}
+
+
+int BatchEvaluator::GetSize(){
+  return size;
+}
+
+
+short BatchEvaluator::GetDimSize(){
+  return dimSize;
+}
+
+
+/**
+ * Score every position of the batch, one block of boards at a time
+ */
+void BatchEvaluator::Evaluate(int* scores, uint8_t* status){
+  C5_TRACE_SCOPE("BatchEvaluator::Evaluate");
+  int32_t blockScores[BLOCK_SIZE], blockStatus[BLOCK_SIZE];
+
+  for (int first=0; first<size; first+=BLOCK_SIZE){
+    evaluateBlock(first, blockScores, blockStatus);
+
+    int count = (size-first < BLOCK_SIZE) ? size-first : BLOCK_SIZE;
+    for (int b=0; b<count; b++){
+      if (scores != nullptr)
+        scores[first+b] = blockScores[b];
+      if (status != nullptr)
+        status[first+b] = (uint8_t)blockStatus[b];
+    }
+  }
+}
+
+
+/**
+ * a where mask is -1, b where it is 0
+ */
+static inline int32_t select(int32_t mask, int32_t a, int32_t b){
+  return b ^ ((a ^ b) & mask);
+}
+
+
+/**
+ * Stream every line through the run state machine for boards [first, first+BLOCK_SIZE)
+ *
+ * Per board, a run of runColor stones of length runLen is open while the cells after it are empty:
+ * it is scored once the next stone or the end of the line tells how many spaces follow it (gap).
+ * runBefore holds the spaces that preceded it. This is the walk of assessLine and isBounded, with
+ * every decision turned into arithmetic on masks.
+ */
+void BatchEvaluator::evaluateBlock(int first, int32_t* blockScores, int32_t* blockStatus){
+  // all lane state is local so that the compiler sees no aliasing
+  int32_t runColor[BLOCK_SIZE], runLen[BLOCK_SIZE], runBefore[BLOCK_SIZE], gap[BLOCK_SIZE];
+  int32_t scores[BLOCK_SIZE], status[BLOCK_SIZE], empty[BLOCK_SIZE];
+
+  // the weights of each length for the four combinations of color and openness,
+  // picked with selects rather than a table lookup, which would need a gather
+  int32_t humanOneSided[EvalParams::MAX_LENGTH], humanUnbounded[EvalParams::MAX_LENGTH];
+  int32_t aiOneSided[EvalParams::MAX_LENGTH], aiUnbounded[EvalParams::MAX_LENGTH];
+  for (short l=1; l<=EvalParams::MAX_LENGTH; l++){
+    humanOneSided[l-1] = weights[EvalParams::Index(false, false, l)];
+    humanUnbounded[l-1] = weights[EvalParams::Index(false, true, l)];
+    aiOneSided[l-1] = weights[EvalParams::Index(true, false, l)];
+    aiUnbounded[l-1] = weights[EvalParams::Index(true, true, l)];
+  }
+
+  for (int b=0; b<BLOCK_SIZE; b++){
+    scores[b] = 0;
+    status[b] = 0;
+    empty[b] = 0;
+  }
+
+  for (int ind=0; ind<dimSize*dimSize; ind++){
+    const int8_t* v = &cells[ind*stride + first];
+    for (int b=0; b<BLOCK_SIZE; b++)
+      empty[b] |= (v[b] == 0);
+  }
+
+  for (size_t line=0; line+1<lineStarts.size(); line++){
+    for (int b=0; b<BLOCK_SIZE; b++){
+      runColor[b] = 0;
+      runLen[b] = 0;
+      runBefore[b] = 0;
+      gap[b] = 0;
+    }
+
+    // one extra step onto a wall past the end of the line closes the last run
+    for (int k=lineStarts[line]; k<=lineStarts[line+1]; k++){
+      const int8_t* v = (k < lineStarts[line+1]) ? &cells[lineCells[k]*stride + first] : lineEnd;
+
+      for (int b=0; b<BLOCK_SIZE; b++){
+        // conditions are masks, 0 or -1, combined with bitwise operations only
+        int32_t color = v[b];
+        int32_t isStone = -(int32_t)(color != 0);
+        int32_t extend = isStone & -(int32_t)(gap[b] == 0) & -(int32_t)(runColor[b] == color);
+        int32_t start = isStone & ~extend;
+        int32_t close = start & -(int32_t)(runLen[b] > 0);
+
+        // score the closing run, gap being the spaces after it
+        int32_t isAI = -(int32_t)(runColor[b] == AI_FIVE);
+        int32_t unbounded = -(int32_t)(runBefore[b] > 0) & -(int32_t)(gap[b] > 0);
+        int32_t open = -(int32_t)(runLen[b] + runBefore[b] + gap[b] >= 5);
+        int32_t weight = 0;
+        for (int l=0; l<EvalParams::MAX_LENGTH; l++){
+          int32_t human = select(unbounded, humanUnbounded[l], humanOneSided[l]);
+          int32_t ai = select(unbounded, aiUnbounded[l], aiOneSided[l]);
+          // lengths above MAX_LENGTH score as MAX_LENGTH
+          int32_t isLength = -(int32_t)((l == EvalParams::MAX_LENGTH-1) ? (runLen[b] > l) : (runLen[b] == l+1));
+          weight |= select(isAI, ai, human) & isLength;
+        }
+        scores[b] += weight & close & open;
+        status[b] |= runColor[b] & close & -(int32_t)(runLen[b] >= 5);
+
+        // start a new run on any other stone
+        runLen[b] = select(start, 1, runLen[b] - extend);
+        runBefore[b] = select(start, gap[b], runBefore[b]);
+        runColor[b] = select(start, color, runColor[b]);
+        gap[b] = (gap[b] + 1) & ~isStone;
+      }
+    }
+  }
+
+  for (int b=0; b<BLOCK_SIZE; b++){
+    blockScores[b] = scores[b];
+    blockStatus[b] = status[b] | (empty[b] ? 0 : FULL);
+  }
+}
+
+
+/**
+ * GameLogic::Arbitrate(side) for a position with the given status bits
+ */
+GameLogic::Arbitration BatchEvaluator::Arbitrate(uint8_t status, char side){
+  uint8_t five = (side == AI_COLOR) ? AI_FIVE : HUMAN_FIVE;
+  if (status & five)
+    return GameLogic::WIN;
+  if (status & FULL)
+    return GameLogic::DRAW;
+  return GameLogic::NONE;
+}
@@ -0,0 +1,79 @@
+#ifndef BATCH_EVALUATOR_H
+#define BATCH_EVALUATOR_H
+
+#include <stdint.h>
+#include <vector>
+#include "EvalParams.h"
+#include "GameLogic.h"
+
+/**
+ * Scores many positions of the same board size at once, with the same result as assessBoard
+ *
+ * Positions are stored structure-of-arrays: cell-major, board-minor, so the values of one cell for
+ * a block of BLOCK_SIZE boards are contiguous. Every line of the board is streamed once through a
+ * small run-tracking state machine that is kept for a whole block of boards, so the inner loops run
+ * across boards with no branches and vectorize. The same pass finds the fives of both sides and
+ * whether each board is full.
+ */
+class BatchEvaluator
+{
+public:
+  BatchEvaluator(short _dim, int _capacity);
+  ~BatchEvaluator();
+
+  void SetEvalParams(const EvalParams& _params);
+
+  /**
+   * Append a position, dimSize*dimSize characters row by row as in GameLogic::SetPosition
+   * Return its index in the batch, or -1 if the batch is full or cells is malformed
+   */
+  int Add(const char* cells);
+  void Clear();
+  int GetSize();
+  short GetDimSize();
+
+  /**
+   * Status bits of a position: a side has five or more in a row, the board is full
+   */
+  static const uint8_t HUMAN_FIVE = 1;
+  static const uint8_t AI_FIVE = 2;
+  static const uint8_t FULL = 4;
+
+  /**
+   * Score every position of the batch, and fill status with its status bits
+   * Either output may be null
+   */
+  void Evaluate(int* scores, uint8_t* status);
+
+  /**
+   * GameLogic::Arbitrate(side) for a position with the given status bits, except that a draw is
+   * only reported once the board is full
+   */
+  static GameLogic::Arbitration Arbitrate(uint8_t status, char side);
+
+  static const int BLOCK_SIZE = 64;
+
+private:
+  short dimSize;
+  int capacity;
+  int size;
+
+  // cell codes (0 = empty, HUMAN_FIVE = human, AI_FIVE = AI), [dimSize*dimSize][capacity rounded up to BLOCK_SIZE]
+  int8_t* cells;
+  int stride;
+
+  // cell code beyond the edges, and a block of it
+  static const int8_t WALL = 3;
+  int8_t lineEnd[BLOCK_SIZE];
+
+  // the lines of at least five cells, as consecutive cell indices
+  std::vector<short> lineCells;
+  std::vector<int> lineStarts;
+
+  // pattern weights, indexed by EvalParams::Index
+  int32_t weights[EvalParams::NUM_PARAMS];
+
+  void evaluateBlock(int first, int32_t* blockScores, int32_t* blockStatus);
+};
+
+#endif
@@ -0,0 +1,304 @@
+#include <chrono>
+#include <new>
+#include "ConnectFiveAPI.h"
+#include "BatchEvaluator.h"
+#include "GameLogic.h"
+
+using namespace std;
+
+// engine defaults when the limits leave them at 0
+#define DEFAULT_DEPTH      4
+#define DEFAULT_MOVE_TIME  3000
+
+// positions scored per BatchEvaluator pass
+#define BATCH_CAPACITY  4096
+
+// boards need room for five, coordinates are shorts
+#define MIN_DIM_SIZE  5
+#define MAX_DIM_SIZE  32767
+
+
+struct c5_engine {
+  GameLogic* game;
+  short dimSize;
+  c5_stats stats;
+};
+
+
+static void clearStats(c5_stats* stats){
+  stats->nodes = 0;
+  stats->playouts = 0;
+  stats->tree_nodes = 0;
+  stats->depth = 0;
+  stats->elapsed_ms = 0;
+}
+
+
+/**
+ * Minimax to depth plies within timeLimitMs, deepening one ply at a time from 1
+ * The greedy move stands if not even depth 1 completes
+ */
+static int searchIterative(c5_engine* engine, short depth, int timeLimitMs, short* row, short* col){
+  GameLogic* game = engine->game;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  short difficulty = game->GetDifficulty();
+  game->SetDifficulty(C5_GREEDY);
+  bool found = game->FindAIMove(row, col);
+  game->SetDifficulty(difficulty);
+  if (!found)
+    return C5_BOARD_FULL;
+  engine->stats.nodes = game->GetNodeCount();
+
+  for (short d=1; d<=depth; d++){
+    int elapsed = (int)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    if (elapsed >= timeLimitMs)
+      break;
+
+    short r, c;
+    bool completed = game->SearchBestMove(d, timeLimitMs-elapsed, &r, &c);
+    engine->stats.nodes += game->GetNodeCount();
+    if (!completed)
+      break;
+
+    engine->stats.depth = d;
+    (*row) = r;
+    (*col) = c;
+  }
+
+  return C5_OK;
+}
+
+
+c5_engine* c5_create(int dim_size){
+  if (dim_size != C5_UNBOUNDED && (dim_size < MIN_DIM_SIZE || dim_size > MAX_DIM_SIZE))
+    return nullptr;
+
+  c5_engine* engine = new (nothrow) c5_engine;
+  if (engine == nullptr)
+    return nullptr;
+
+  try {
+    engine->game = new GameLogic((short)dim_size, C5_MINIMAX);
+  } catch (...){
+    delete engine;
+    return nullptr;
+  }
+
+  engine->dimSize = (short)dim_size;
+  clearStats(&engine->stats);
+  return engine;
+}
+
+
+void c5_destroy(c5_engine* engine){
+  if (engine == nullptr)
+    return;
+
+  delete engine->game;
+  delete engine;
+}
+
+
+int c5_set_rules(c5_engine* engine, int rules){
+  if (engine == nullptr)
+    return C5_INVALID_ARGUMENT;
+
+  if (rules == C5_FREESTYLE)
+    engine->game->SetRules(FREESTYLE_RULES);
+  else if (rules == C5_EXACT_FIVE)
+    engine->game->SetRules(EXACT_FIVE_RULES);
+  else if (rules == C5_RENJU)
+    engine->game->SetRules(RENJU_RULES);
+  else
+    return C5_INVALID_ARGUMENT;
+
+  return C5_OK;
+}
+
+
+int c5_reset(c5_engine* engine){
+  if (engine == nullptr)
+    return C5_INVALID_ARGUMENT;
+
+  try {
+    engine->game->SetBoardSize(engine->dimSize);
+  } catch (const bad_alloc&){
+    return C5_OUT_OF_MEMORY;
+  } catch (...){
+    return C5_INTERNAL_ERROR;
+  }
+  return C5_OK;
+}
+
+
+int c5_set_position(c5_engine* engine, const char* cells){
+  if (engine == nullptr || cells == nullptr)
+    return C5_INVALID_ARGUMENT;
+
+  return engine->game->SetPosition(cells) ? C5_OK : C5_INVALID_ARGUMENT;
+}
+
+
+int c5_load_solved(c5_engine* engine, const char* path){
+  if (engine == nullptr || path == nullptr)
+    return C5_INVALID_ARGUMENT;
+
+  try {
+    return engine->game->LoadSolvedTable(path) ? C5_OK : C5_INVALID_ARGUMENT;
+  } catch (const bad_alloc&){
+    return C5_OUT_OF_MEMORY;
+  } catch (...){
+    return C5_INTERNAL_ERROR;
+  }
+}
+
+
+int c5_play(c5_engine* engine, int row, int col, char side){
+  if (engine == nullptr || (side != C5_HUMAN && side != C5_AI))
+    return C5_INVALID_ARGUMENT;
+  if (row < -MAX_DIM_SIZE || row > MAX_DIM_SIZE || col < -MAX_DIM_SIZE || col > MAX_DIM_SIZE)
+    return C5_ILLEGAL_MOVE;
+
+  // sparse boards allocate tiles, the Monte Carlo tree its nodes
+  try {
+    return engine->game->PlayMove((short)row, (short)col, side) ? C5_OK : C5_ILLEGAL_MOVE;
+  } catch (const bad_alloc&){
+    return C5_OUT_OF_MEMORY;
+  } catch (...){
+    return C5_INTERNAL_ERROR;
+  }
+}
+
+
+int c5_search(c5_engine* engine, const c5_limits* limits, int* row, int* col){
+  if (engine == nullptr || row == nullptr || col == nullptr)
+    return C5_INVALID_ARGUMENT;
+
+  c5_limits defaults = {C5_MINIMAX, 0, 0, 0};
+  if (limits == nullptr)
+    limits = &defaults;
+  if (limits->algorithm < C5_GREEDY || limits->algorithm > C5_MCTS || limits->depth < 0 ||
+      limits->time_ms < 0 || limits->threads < 0)
+    return C5_INVALID_ARGUMENT;
+
+  GameLogic* game = engine->game;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  clearStats(&engine->stats);
+
+  short depth = (short)((limits->depth > 0) ? limits->depth : DEFAULT_DEPTH);
+  short r = -1, c = -1;
+  int result = C5_OK;
+
+  try {
+    if (limits->algorithm == C5_MINIMAX && limits->time_ms > 0){
+      // FindAIMove looks for solved moves itself, the iterative deepening does not
+      if (game->FindSolvedMove(&r, &c))
+        engine->stats.nodes = game->GetNodeCount();
+      else
+        result = searchIterative(engine, depth, limits->time_ms, &r, &c);
+
+    } else {
+      game->SetDifficulty((short)limits->algorithm);
+      game->SetSearchDepth(depth);
+      game->SetMoveTime((limits->time_ms > 0) ? limits->time_ms : DEFAULT_MOVE_TIME);
+      game->SetThreads((short)limits->threads);
+
+      if (!game->FindAIMove(&r, &c))
+        result = C5_BOARD_FULL;
+
+      engine->stats.nodes = game->GetNodeCount();
+      engine->stats.playouts = game->GetPlayoutCount();
+      engine->stats.tree_nodes = game->GetTreeNodeCount();
+      if (limits->algorithm == C5_MINIMAX)
+        engine->stats.depth = depth;
+    }
+  } catch (const bad_alloc&){
+    result = C5_OUT_OF_MEMORY;
+  } catch (...){
+    // the Monte Carlo search could not start its threads
+    result = C5_INTERNAL_ERROR;
+  }
+
+  engine->stats.elapsed_ms = (int)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+  if (result == C5_OK){
+    (*row) = r;
+    (*col) = c;
+  }
+  return result;
+}
+
+
+int c5_status(c5_engine* engine, char side){
+  if (engine == nullptr || (side != C5_HUMAN && side != C5_AI))
+    return C5_INVALID_ARGUMENT;
+
+  GameLogic::Arbitration state = engine->game->Arbitrate(side);
+  if (state == GameLogic::WIN)
+    return C5_STATUS_WIN;
+  if (state == GameLogic::DRAW)
+    return C5_STATUS_DRAW;
+  return C5_STATUS_NONE;
+}
+
+
+void c5_get_stats(c5_engine* engine, c5_stats* stats){
+  if (engine == nullptr || stats == nullptr)
+    return;
+
+  (*stats) = engine->stats;
+}
+
+
+void c5_trace_begin(c5_engine* engine){
+  if (engine == nullptr)
+    return;
+
+  engine->game->BeginTrace();
+}
+
+
+int c5_trace_export(c5_engine* engine, const char* path){
+  if (engine == nullptr || path == nullptr)
+    return C5_INVALID_ARGUMENT;
+
+  try {
+    return engine->game->ExportTrace(path) ? C5_OK : C5_INVALID_ARGUMENT;
+  } catch (const bad_alloc&){
+    return C5_OUT_OF_MEMORY;
+  } catch (...){
+    return C5_INTERNAL_ERROR;
+  }
+}
+
+
+int c5_evaluate_batch(int dim_size, int count, const char* const* positions, int* scores, unsigned char* status){
+  if (dim_size < MIN_DIM_SIZE || dim_size > MAX_DENSE_SIZE || count < 0 || (count > 0 && positions == nullptr))
+    return C5_INVALID_ARGUMENT;
+
+  BatchEvaluator* batch;
+  try {
+    batch = new BatchEvaluator((short)dim_size, BATCH_CAPACITY);
+  } catch (const bad_alloc&){
+    return C5_OUT_OF_MEMORY;
+  }
+
+  int result = C5_OK;
+  for (int first=0; first<count && result == C5_OK; first+=BATCH_CAPACITY){
+    int n = (count-first < BATCH_CAPACITY) ? count-first : BATCH_CAPACITY;
+
+    batch->Clear();
+    for (int k=0; k<n; k++){
+      if (positions[first+k] == nullptr || batch->Add(positions[first+k]) < 0){
+        result = C5_INVALID_ARGUMENT;
+        break;
+      }
+    }
+
+    if (result == C5_OK)
+      batch->Evaluate((scores != nullptr) ? scores+first : nullptr, (status != nullptr) ? status+first : nullptr);
+  }
+
+  delete batch;
+  return result;
+}
@@ -0,0 +1,165 @@
+#ifndef CONNECT_FIVE_API_H
+#define CONNECT_FIVE_API_H
+
+/**
+ * C interface to the engine, for linking it into other programs
+ *
+ * Every engine is independent: distinct engines may be used from different threads at the same
+ * time, a single engine must not be used by two threads at once.
+ * Rows and columns are 0-based; on an unbounded board they may be negative.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32) && defined(CONNECTFIVE_SHARED)
+  #ifdef CONNECTFIVE_EXPORTS
+    #define C5_API __declspec(dllexport)
+  #else
+    #define C5_API __declspec(dllimport)
+  #endif
+#elif defined(__GNUC__)
+  #define C5_API __attribute__((visibility("default")))
+#else
+  #define C5_API
+#endif
+
+// return codes
+#define C5_OK               0
+#define C5_INVALID_ARGUMENT -1
+#define C5_ILLEGAL_MOVE     -2
+#define C5_BOARD_FULL       -3
+// the engine ran out of memory, or failed otherwise (threads exhausted); it may then only be
+// reset or destroyed
+#define C5_OUT_OF_MEMORY    -4
+#define C5_INTERNAL_ERROR   -5
+
+// stone colors, as in GameLogic
+#define C5_EMPTY  '\0'
+#define C5_HUMAN  'B'
+#define C5_AI     'W'
+
+// board size of an unbounded board
+#define C5_UNBOUNDED  0
+
+// game status for a side, see c5_status
+#define C5_STATUS_NONE  0
+#define C5_STATUS_WIN   1
+#define C5_STATUS_DRAW  2
+
+// rule variants, see RuleVariants.h; C5_HUMAN plays black
+#define C5_FREESTYLE   0
+#define C5_EXACT_FIVE  1
+#define C5_RENJU       2
+
+// search algorithms
+#define C5_GREEDY   1
+#define C5_MINIMAX  2
+#define C5_MCTS     3
+
+typedef struct c5_engine c5_engine;
+
+/**
+ * Limits of c5_search
+ * C5_MINIMAX deepens iteratively up to depth plies (0 = the engine default) within time_ms,
+ * without a time limit it searches depth plies directly.
+ * C5_MCTS searches for time_ms (0 = the engine default) on threads threads (0 = all), it
+ * plays freestyle only and is replaced by minimax under the other rules.
+ */
+typedef struct c5_limits {
+  int algorithm;
+  int depth;
+  int time_ms;
+  int threads;
+} c5_limits;
+
+/**
+ * Statistics of the last c5_search
+ */
+typedef struct c5_stats {
+  unsigned int nodes;
+  int playouts;
+  int tree_nodes;
+  // deepest completed minimax depth
+  int depth;
+  int elapsed_ms;
+} c5_stats;
+
+/**
+ * Create an engine for a dim_size x dim_size board, or an unbounded board with C5_UNBOUNDED
+ * Return NULL if dim_size is invalid or memory is exhausted
+ */
+C5_API c5_engine* c5_create(int dim_size);
+C5_API void c5_destroy(c5_engine* engine);
+
+/**
+ * Rules of the game, C5_FREESTYLE by default
+ * Under C5_RENJU, c5_play refuses the forbidden moves of C5_HUMAN and c5_search avoids them
+ */
+C5_API int c5_set_rules(c5_engine* engine, int rules);
+
+/**
+ * Empty the board
+ * C5_OUT_OF_MEMORY if the board cannot be allocated again, the engine may then only be destroyed
+ */
+C5_API int c5_reset(c5_engine* engine);
+
+/**
+ * Replace the board with cells, dim_size*dim_size characters row by row,
+ * '.' = empty, C5_HUMAN or C5_AI. Not available on boards stored sparsely
+ */
+C5_API int c5_set_position(c5_engine* engine, const char* cells);
+
+/**
+ * Play the solved positions of a table built by the SolveTable tool for this board size,
+ * c5_search then answers them and proven wins by fours without searching
+ */
+C5_API int c5_load_solved(c5_engine* engine, const char* path);
+
+/**
+ * Place a stone of side at [row, col]
+ */
+C5_API int c5_play(c5_engine* engine, int row, int col, char side);
+
+/**
+ * Search the best move for C5_AI within limits (NULL = engine defaults) without playing it
+ * Return C5_BOARD_FULL, leaving row and col as they are, if there is no move to play, and
+ * C5_OUT_OF_MEMORY or C5_INTERNAL_ERROR if the search failed
+ */
+C5_API int c5_search(c5_engine* engine, const c5_limits* limits, int* row, int* col);
+
+/**
+ * C5_STATUS_WIN if side has five, C5_STATUS_DRAW if neither side can make five any more,
+ * C5_STATUS_NONE otherwise
+ */
+C5_API int c5_status(c5_engine* engine, char side);
+
+C5_API void c5_get_stats(c5_engine* engine, c5_stats* stats);
+
+/**
+ * Latency tracing, when the library is built with CONNECTFIVE_TRACE: c5_trace_export writes the
+ * spans recorded since c5_trace_begin on engine to path, in the Chrome trace-event format.
+ * Spans are recorded process-wide: the trace also holds the searches of every other engine
+ * running meanwhile. Searching does not move the start set by c5_trace_begin.
+ * C5_INVALID_ARGUMENT if tracing is not compiled in or path cannot be written
+ */
+C5_API void c5_trace_begin(c5_engine* engine);
+C5_API int c5_trace_export(c5_engine* engine, const char* path);
+
+/**
+ * Score count positions of a dim_size board at once with the default pattern weights and freestyle
+ * rules, without an engine. positions[k] is formatted as for c5_set_position.
+ * status[k] gets C5_HUMAN_FIVE and C5_AI_FIVE if a side has five in a row, C5_FULL if the board
+ * is full. Either output may be NULL
+ */
+#define C5_HUMAN_FIVE  1
+#define C5_AI_FIVE     2
+#define C5_FULL        4
+C5_API int c5_evaluate_batch(int dim_size, int count, const char* const* positions, int* scores, unsigned char* status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "EvalParams.h"
+
+using namespace std;
+
+
+/**
+ * Constructor
+ * Defaults are the original hand-tuned values
+ */
+EvalParams::EvalParams()
+{
+  const int defaults[NUM_SIDES][NUM_OPENNESS][MAX_LENGTH] = {
+    // human: one sided, unbounded
+    { {-1, -2, -20, -400, -4000}, {-3, -50, -150, -500, -4000} },
+    // AI: one sided, unbounded
+    { { 1,  2,  15,  150,  4000}, { 2,  40,   90,  300,  4000} }
+  };
+
+  for (short s=0; s<NUM_SIDES; s++)
+    for (short o=0; o<NUM_OPENNESS; o++)
+      for (short l=1; l<=MAX_LENGTH; l++)
+        weights[Index(s==1, o==1, l)] = defaults[s][o][l-1];
+}
+
+
+/**
+ * Flat index of a pattern, length is clamped to [1, MAX_LENGTH]
+ */
+short EvalParams::Index(bool isAI, bool isUnbounded, short length){
+  length = (length<1) ? 1 : ((length>MAX_LENGTH) ? MAX_LENGTH : length);
+  return ((isAI?1:0)*NUM_OPENNESS + (isUnbounded?1:0))*MAX_LENGTH + length-1;
+}
+
+
+int EvalParams::Get(short index){
+  return weights[index];
+}
+
+
+void EvalParams::Set(short index, int value){
+  weights[index] = value;
+}
+
+
+int EvalParams::Score(bool isAI, bool isUnbounded, short length){
+  if (length <= 0)
+    return 0;
+
+  return weights[Index(isAI, isUnbounded, length)];
+}
+
+
+/**
+ * Read the text format, see header
+ */
+bool EvalParams::Load(const char* path){
+  ifstream in(path);
+  if (!in)
+    return false;
+
+  int loaded[NUM_PARAMS];
+  bool seen[NUM_SIDES*NUM_OPENNESS] = {false};
+
+  string line;
+  while (getline(in, line)){
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    stringstream ss(line);
+    string side, openness;
+    if (!(ss >> side >> openness))
+      continue;
+
+    if ((side != "human" && side != "ai") || (openness != "one_sided" && openness != "unbounded"))
+      return false;
+
+    bool isAI = (side == "ai");
+    bool isUnbounded = (openness == "unbounded");
+    for (short l=1; l<=MAX_LENGTH; l++){
+      if (!(ss >> loaded[Index(isAI, isUnbounded, l)]))
+        return false;
+    }
+    seen[(isAI?1:0)*NUM_OPENNESS + (isUnbounded?1:0)] = true;
+  }
+
+  // only replace the table if every row is present
+  for (short k=0; k<NUM_SIDES*NUM_OPENNESS; k++){
+    if (!seen[k])
+      return false;
+  }
+
+  for (short k=0; k<NUM_PARAMS; k++)
+    weights[k] = loaded[k];
+
+  return true;
+}
+
+
+/**
+ * Write the text format, see header
+ */
+bool EvalParams::Save(const char* path){
+  ofstream out(path);
+  if (!out)
+    return false;
+
+  out << "# side openness len1 len2 len3 len4 len5+" << endl;
+  for (short s=0; s<NUM_SIDES; s++){
+    for (short o=0; o<NUM_OPENNESS; o++){
+      out << (s==1 ? "ai" : "human") << " " << (o==1 ? "unbounded" : "one_sided");
+      for (short l=1; l<=MAX_LENGTH; l++)
+        out << " " << weights[Index(s==1, o==1, l)];
+      out << endl;
+    }
+  }
+
+  return (bool)out;
+}
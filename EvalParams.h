@@ -0,0 +1,42 @@
+#ifndef EVAL_PARAMS_H
+#define EVAL_PARAMS_H
+
+/**
+ * Pattern weights used by GameLogic::scoreFunction
+ *
+ * A run of same-colored stones is scored by its color, whether it is open on both sides or on
+ * one side only, and its length (1 to 5, where 5 also covers longer runs). Runs that cannot
+ * grow to five are always worth 0 and are not part of the table.
+ */
+class EvalParams
+{
+public:
+  EvalParams();
+
+  static const short NUM_SIDES = 2;       // 0 = human, 1 = AI
+  static const short NUM_OPENNESS = 2;    // 0 = one sided, 1 = unbounded
+  static const short MAX_LENGTH = 5;
+  static const short NUM_PARAMS = NUM_SIDES*NUM_OPENNESS*MAX_LENGTH;
+
+  /**
+   * Flat index of a pattern, length is clamped to [1, MAX_LENGTH]
+   */
+  static short Index(bool isAI, bool isUnbounded, short length);
+
+  int Get(short index);
+  void Set(short index, int value);
+  int Score(bool isAI, bool isUnbounded, short length);
+
+  /**
+   * Read or write the text format:
+   * one line per side and openness, "<human|ai> <one_sided|unbounded> len1 len2 len3 len4 len5"
+   * Lines starting with # are comments. Return false on I/O or parse errors
+   */
+  bool Load(const char* path);
+  bool Save(const char* path);
+
+private:
+  int weights[NUM_PARAMS];
+};
+
+#endif
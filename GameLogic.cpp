@@ -1,14 +1,19 @@
-#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <string.h>
 #include <time.h>
 #include "GameLogic.h"
 #include "GameMove.h"
+#include "Trace.h"
 
 using namespace std;
 
-#define PRINT_TOTAL_NODES
-#ifdef PRINT_TOTAL_NODES
-unsigned int totalNodes = 0;
-#endif
+// nodes between two checks of the search deadline
+#define DEADLINE_CHECK_INTERVAL 1024
+// transposition table entries of the forced win search, as a power of two
+#define PROOF_TABLE_BITS  16
+// five-cell windows through a cell, five per direction
+#define WINDOWS_PER_CELL  20
 
 /**
  * Constructor
@@ -17,7 +22,22 @@ GameLogic::GameLogic(short dim, short _difficulty)
 {
   dimSize = dim;
   difficulty = _difficulty;
-  newBoard(&board);
+  rules = FREESTYLE_RULES;
+  allocateBoard();
+
+  mcts = nullptr;
+  solver = nullptr;
+  moveTime = 3000;
+  threads = 0;
+  traceStart = 0;
+  traceCount = 0;
+
+  searchDepth = 4;
+  totalNodes = 0;
+  playouts = 0;
+  treeNodes = 0;
+  hasDeadline = false;
+  aborted = false;
 }
 
 
@@ -26,56 +46,74 @@ GameLogic::GameLogic(short dim, short _difficulty)
  */
 GameLogic::~GameLogic(void)
 {
-  deleteBoard(board);
+  releaseBoard();
+  delete mcts;
+  delete solver;
 }
 
 
 /**
- * Print board to stdio
+ * Print board to out
  */
-void GameLogic::PrintBoard(){
-  cout << std::endl;
+void GameLogic::PrintBoard(ostream& out){
+  // a sparse board is printed around its stones
+  short rowBegin = 0, colBegin = 0, rowEnd = dimSize-1, colEnd = dimSize-1;
+  if (sparse != nullptr){
+    const short MARGIN = 3;
+    short lowest = (dimSize == UNBOUNDED_SIZE) ? -SparseBoard::LIMIT : 0;
+    short highest = (dimSize == UNBOUNDED_SIZE) ? SparseBoard::LIMIT : dimSize-1;
+
+    if (!sparse->GetBounds(&rowBegin, &colBegin, &rowEnd, &colEnd))
+      rowBegin = colBegin = rowEnd = colEnd = (dimSize == UNBOUNDED_SIZE) ? 0 : dimSize/2;
+
+    rowBegin = max((short)(rowBegin-MARGIN), lowest);
+    colBegin = max((short)(colBegin-MARGIN), lowest);
+    rowEnd = min((short)(rowEnd+MARGIN), highest);
+    colEnd = min((short)(colEnd+MARGIN), highest);
+  }
+
+  out << std::endl;
 
-  for (short i=0; i<dimSize; i++){
+  for (short i=rowBegin; i<=rowEnd; i++){
     // first row
-    if (i==0){
+    if (i==rowBegin){
       // print col id
-      for (short j=0; j<dimSize; j++){
-        if (j==0)
-          cout << "  ";
-        cout << j%10 << " ";
+      for (short j=colBegin; j<=colEnd; j++){
+        if (j==colBegin)
+          out << "  ";
+        out << (j%10+10)%10 << " ";
       }
-      cout << endl;
+      out << endl;
 
       // print top boundary
-      for (short j=0; j<dimSize; j++){
-        if (j==0)
-          cout << " -";
-        cout << "--";
+      for (short j=colBegin; j<=colEnd; j++){
+        if (j==colBegin)
+          out << " -";
+        out << "--";
       }
-      cout << endl;
+      out << endl;
     }
 
     // print middle layer
-    for (short j=0; j<dimSize; j++){
-      if (j==0)
-        cout << i%10 << "|";
+    for (short j=colBegin; j<=colEnd; j++){
+      if (j==colBegin)
+        out << (i%10+10)%10 << "|";
 
-      if (board[i*dimSize+j] != '\0')
-        cout << board[i*dimSize+j] << "|";
+      if (cellAt(i,j) != '\0')
+        out << cellAt(i,j) << "|";
       else
-        cout << " " << "|";
+        out << " " << "|";
     }
-    cout << endl;
+    out << endl;
 
     // print bottom boundary
-    for (short j=0; j<dimSize; j++){
-      if (j==0)
-        cout << " -";
+    for (short j=colBegin; j<=colEnd; j++){
+      if (j==colBegin)
+        out << " -";
 
-      cout << "--";
+      out << "--";
     }
-    cout << endl;
+    out << endl;
   }
 }
 
@@ -85,87 +123,193 @@ void GameLogic::PrintBoard(){
  * Return true if it's a valid move
  */
 bool GameLogic::SetMove(short i, short j){
-  if (i>=0 && i<dimSize && j>=0 && j<dimSize && board[i*dimSize+j] == UNOCCUPIED){
-    board[i*dimSize+j] = HUMAN_COLOR;
-    return true;
-  }
+  return PlayMove(i, j, HUMAN_COLOR);
+}
 
-  return false;
+
+/**
+ * Place a stone of side at [row, col]
+ * Return true if it's a valid move
+ */
+bool GameLogic::PlayMove(short row, short col, char side){
+  if ((side != HUMAN_COLOR && side != AI_COLOR) || !onBoard(row,col) || cellAt(row,col) != UNOCCUPIED)
+    return false;
+  if (rules == RENJU_RULES && side == HUMAN_COLOR && isForbiddenMove(row, col))
+    return false;
+
+  setCell(row, col, side);
+
+  if (mcts != nullptr)
+    mcts->Advance(row, col, side);
+  return true;
 }
 
 
 /**
  * AI player set move
  */
-void GameLogic::AIMakeMove(short *row, short *col){
-  short max_move_row = -1, max_move_col = -1;
+bool GameLogic::AIMakeMove(short *row, short *col){
+  bool found;
+#ifdef CONNECTFIVE_TRACE
+  // the move is exported from its own start, the session of BeginTrace is left as it is
+  int64_t moveStart = Trace::Now();
+#endif
+  {
+    C5_TRACE_SCOPE("AIMakeMove");
+    found = FindAIMove(row, col);
+    if (found)
+      PlayMove(*row, *col, AI_COLOR);
+  }
+
+#ifdef CONNECTFIVE_TRACE
+  // the traced threads have all finished by now
+  if (!tracePrefix.empty()){
+    traceCount++;
+    string path = tracePrefix + "-" + to_string(traceCount) + ".json";
+    Trace::Export(path.c_str(), moveStart);
+  }
+#endif
+  return found;
+}
+
+
+/**
+ * Find the AI move at the current difficulty without playing it
+ * Return false if there is no move to play, the board being full
+ */
+bool GameLogic::FindAIMove(short *row, short *col){
+  if (rules == EXACT_FIVE_RULES)
+    return findAIMove<ExactFiveRules>(row, col);
+  else if (rules == RENJU_RULES)
+    return findAIMove<RenjuRules>(row, col);
+  return findAIMove<FreestyleRules>(row, col);
+}
+
+
+template<class Rules>
+bool GameLogic::findAIMove(short *row, short *col){
+  C5_TRACE_SCOPE("FindAIMove");
+  short max_move_row = NULL_MOVE_ROW, max_move_col = NULL_MOVE_ROW;
   int max_score = 0;
 
+  totalNodes = 0;
+  playouts = 0;
+  treeNodes = 0;
+
+  // nothing to search around on an empty board, take the centre
+  int stones = countStones();
+  if (stones == 0){
+    (*row) = (*col) = (dimSize == UNBOUNDED_SIZE) ? 0 : dimSize/2;
+    return true;
+  }
+  if (dimSize != UNBOUNDED_SIZE && stones == (int)dimSize*dimSize)
+    return false;
+
+  // a solved position or a forced win needs no search
+  if (difficulty > 1 && FindSolvedMove(row, col))
+    return true;
+
   if (difficulty == 1){
     // find the highest score and make the move. Greedy algorithm
 
     // find empty moves
-    for (short i=0; i<dimSize; i++){
-      for (short j=0; j<dimSize; j++){
-        short ind = i*dimSize+j;
-        if (isMoveAdmissible(i,j)){
-          // temporarily put a move there
-          board[ind] = AI_COLOR;
-
-          // assess board and get score
-          int score = assessBoard();
-
-          if ((max_move_row < 0 || max_move_col < 0) || score > max_score){
-            max_move_row = i;
-            max_move_col = j;
-            max_score = score;
-          }
+    vector<CandidateMove> cells;
+    admissibleCells(&cells);
+    for (size_t k=0; k<cells.size(); k++){
+      short i = cells[k].row, j = cells[k].col;
 
-          // remove the move
-          board[ind] = UNOCCUPIED;
-        }
+      // temporarily put a move there
+      setCell(i, j, AI_COLOR);
+
+      // assess board and get score
+      int score = evaluateBoard<Rules>();
+
+      if (k == 0 || score > max_score){
+        max_move_row = i;
+        max_move_col = j;
+        max_score = score;
       }
-    }
 
-    // make the permanent move
-    board[max_move_row*dimSize + max_move_col] = AI_COLOR;
-    (*row) = max_move_row;
-    (*col) = max_move_col;
+      // remove the move
+      setCell(i, j, UNOCCUPIED);
+    }
+    totalNodes = (unsigned int)cells.size();
 
   }
-  else if (difficulty == 2){
-    // apply minimax to N levels
+  else if (difficulty == 2 || sparse != nullptr || Rules::VARIANT != FREESTYLE_RULES){
+    // apply minimax to searchDepth levels
+    // the Monte Carlo tree search plays freestyle on a dense board, other games fall back to minimax
+    searchBestMove<Rules>(searchDepth, 0, &max_move_row, &max_move_col);
+  }
+  else if (difficulty == 3){
+    // Monte Carlo tree search for moveTime
+
+    if (mcts == nullptr)
+      mcts = new MCTSEngine(dimSize);
+    mcts->SetThreads(threads);
+
+    mcts->Search(board, moveTime, &max_move_row, &max_move_col);
+    playouts = mcts->GetPlayouts();
+    treeNodes = mcts->GetNodesUsed();
+    if (max_move_row < 0)
+      max_move_row = max_move_col = NULL_MOVE_ROW;
+  }
 
-    short N = 4; 
-#ifdef PRINT_TOTAL_NODES
-    totalNodes = 0;
-#endif
+  if (max_move_row == NULL_MOVE_ROW)
+    return false;
+  (*row) = max_move_row;
+  (*col) = max_move_col;
+  return true;
+}
 
-    // find empty moves
-    for (short i=0; i<dimSize; i++){
-      for (short j=0; j<dimSize; j++){
-        if (isMoveAdmissible(i,j)){
-          GameMove* move = new GameMove(nullptr, i, j, AI_COLOR);
-          // note: move is deleted from within assessMove
-          int score = assessMove(move, N);
-          if (max_move_row < 0 || max_move_col < 0 || max_score < score){
-            max_score = score;
-            max_move_row = i;
-            max_move_col = j;
-          }
-        }
-      }
-    }
 
-    // make the permanent move
-    board[max_move_row*dimSize + max_move_col] = AI_COLOR;
-    (*row) = max_move_row;
-    (*col) = max_move_col;
+/**
+ * Find the best AI move with minimax to depth plies beneath each root move, without playing it
+ * Return false if timeLimitMs > 0 and the search was aborted
+ */
+bool GameLogic::SearchBestMove(short depth, int timeLimitMs, short *row, short *col){
+  if (rules == EXACT_FIVE_RULES)
+    return searchBestMove<ExactFiveRules>(depth, timeLimitMs, row, col);
+  else if (rules == RENJU_RULES)
+    return searchBestMove<RenjuRules>(depth, timeLimitMs, row, col);
+  return searchBestMove<FreestyleRules>(depth, timeLimitMs, row, col);
+}
+
 
-#ifdef PRINT_TOTAL_NODES
-    cout << "Total nodes traversed: " << totalNodes << endl;
-#endif
+template<class Rules>
+bool GameLogic::searchBestMove(short depth, int timeLimitMs, short *row, short *col){
+  C5_TRACE_SCOPE("SearchBestMove");
+  short max_move_row = NULL_MOVE_ROW, max_move_col = NULL_MOVE_ROW;
+  int max_score = 0;
+
+  totalNodes = 0;
+  aborted = false;
+  hasDeadline = (timeLimitMs > 0);
+  if (hasDeadline)
+    deadline = chrono::steady_clock::now() + chrono::milliseconds(timeLimitMs);
+
+  // every root move gets its exact score, so root moves are kept in board order
+  vector<CandidateMove> cells;
+  admissibleCells(&cells);
+  for (size_t k=0; k<cells.size() && !aborted; k++){
+    C5_TRACE_SCOPE("root move");
+    short i = cells[k].row, j = cells[k].col;
+
+    GameMove* move = new GameMove(nullptr, i, j, AI_COLOR);
+    // note: move is deleted from within assessMove
+    int score = assessMove<Rules>(move, depth);
+    if (k == 0 || max_score < score){
+      max_score = score;
+      max_move_row = i;
+      max_move_col = j;
+    }
   }
+
+  hasDeadline = false;
+  (*row) = max_move_row;
+  (*col) = max_move_col;
+
+  return !aborted && max_move_row != NULL_MOVE_ROW;
 }
 
 
@@ -175,28 +319,36 @@ void GameLogic::AIMakeMove(short *row, short *col){
  * Minimize if move == AI_COLOR
  * Maximize if move == HUMAN_COLOR
  */
-int GameLogic::assessMove(GameMove* move, short levels, bool isAlphaBeta, short alphaBetaExtremum){
-  if (levels <= 0){
-    // Get the actual scores
+template<class Rules>
+int GameLogic::assessMove(GameMove* move, short levels, bool isAlphaBeta, int alphaBetaExtremum){
+  C5_TRACE_SCOPE("assessMove");
+  // Give up on the whole search once past the deadline
+  if (hasDeadline && !aborted && totalNodes % DEADLINE_CHECK_INTERVAL == 0 && chrono::steady_clock::now() > deadline)
+    aborted = true;
+  if (aborted){
+    delete move;
+    return 0;
+  }
 
-#ifdef PRINT_TOTAL_NODES
-    totalNodes++;
-#endif
+  // The ancestors of move are already on the board, place move itself for the duration of the assessment
+  bool isNullMove = (move->row == NULL_MOVE_ROW);
+  if (!isNullMove)
+    setCell(move->row, move->col, move->GetSide());
 
-    // Set the board
-    board[move->row*dimSize+move->col] = move->GetSide();
-    for (GameMove* up=move->parent; up!=nullptr; up=up->parent){
-      board[up->row*dimSize+up->col] = up->GetSide();
+  if (levels <= 0){
+    // Get the actual scores, past any pending threat
+    int score;
+    if (searchParams.quiescence && !isNullMove){
+      quiescenceCount = 0;
+      score = quiesce<Rules>(move->GetSide(), isAlphaBeta, alphaBetaExtremum, 0);
+    } else {
+      totalNodes++;
+      score = evaluateBoard<Rules>();
     }
 
-    int score = assessBoard();
-
     // Unset the board
-    board[move->row*dimSize+move->col] = UNOCCUPIED;
-    for (GameMove* up=move->parent; up!=nullptr; up=up->parent){
-      board[up->row*dimSize+up->col] = UNOCCUPIED;
-    }
-
+    if (!isNullMove)
+      setCell(move->row, move->col, UNOCCUPIED);
     delete move;
 
     return score;
@@ -204,80 +356,356 @@ int GameLogic::assessMove(GameMove* move, short levels, bool isAlphaBeta, short
   } else {
     // Not at the deepest level, branch down
 
+    // child color should be the opposite of the parent color
+    char childSide;
+    if (move->GetSide() == AI_COLOR)
+      childSide = HUMAN_COLOR;
+    else
+      childSide = AI_COLOR;
+    bool isMinimizer = (move->GetSide() == AI_COLOR);
+
+    // Null move: let childSide pass. If move's side still cannot be held to the parent's bound, cut
+    if (searchParams.nullMove && isAlphaBeta && !isNullMove && levels > searchParams.nullMoveReduction){
+      // not while a four or an open three is pending for either side, whichever move made it
+      vector<CandidateMove> fiveCells[2];
+      bool three[2], five[2];
+      scanThreats<Rules>(fiveCells, three, five);
+      bool threat = (three[0] || three[1] || five[0] || five[1] || !fiveCells[0].empty() || !fiveCells[1].empty());
+
+      if (!threat){
+        // the pass is bounded one point past the parent's bound: a pass node cut at its bound
+        // then lands outside it, and a score within it is exact
+        int passBound = isMinimizer ? alphaBetaExtremum+1 : alphaBetaExtremum-1;
+        GameMove* pass = new GameMove(move, NULL_MOVE_ROW, NULL_MOVE_ROW, childSide);
+        int score = assessMove<Rules>(pass, levels-1-searchParams.nullMoveReduction, true, passBound);
+
+        if (!aborted && ((isMinimizer && score < passBound) || (!isMinimizer && score > passBound))){
+          setCell(move->row, move->col, UNOCCUPIED);
+          delete move;
+          return score;
+        }
+      }
+    }
+
+    vector<CandidateMove> children;
+    generateMoves<Rules>(childSide, &children);
+
+    // static score for futility pruning of the leaves
+    bool tryFutility = (searchParams.futility && levels == 1);
+    int staticScore = tryFutility ? evaluateBoard<Rules>() : 0;
+
     bool allBreak = false;
 
-    for (int i=0; i<dimSize && !allBreak; i++){
-      for (int j=0; j<dimSize && !allBreak; j++){
-        // Set the board
-        board[move->row*dimSize+move->col] = move->GetSide();
-        for (GameMove* up=move->parent; up!=nullptr; up=up->parent){
-          board[up->row*dimSize+up->col] = up->GetSide();
-        }
+    for (size_t k=0; k<children.size() && !allBreak; k++){
+      CandidateMove& c = children[k];
 
-        // determine admissibility
-        bool adm = isMoveAdmissible(i,j);
+      // a quiet leaf cannot move the score by more than the margin
+      if (tryFutility && c.quiet && move->IsScoreAssigned()){
+        if ((isMinimizer && staticScore - searchParams.futilityMargin >= move->GetScore()) ||
+            (!isMinimizer && staticScore + searchParams.futilityMargin <= move->GetScore()))
+          continue;
+      }
 
-        // Unset the board
-        board[move->row*dimSize+move->col] = UNOCCUPIED;
-        for (GameMove* up=move->parent; up!=nullptr; up=up->parent){
-          board[up->row*dimSize+up->col] = UNOCCUPIED;
-        }
+      // late quiet moves are searched shallower first
+      bool reduced = (searchParams.lateMoveReductions && c.quiet && k >= (size_t)searchParams.lmrMoves &&
+                      levels-1-searchParams.lmrReduction >= 1);
 
+      GameMove* child = new GameMove(move, c.row, c.col, childSide);
+      int score = assessMove<Rules>(child, reduced ? levels-1-searchParams.lmrReduction : levels-1, move->IsScoreAssigned(), move->GetScore());
 
-        // only assess the cells that are unoccupied
-        if (adm){
-          // child color should be the opposite of the parent color
-          char childSide;
-          if (move->GetSide() == AI_COLOR)
-            childSide = HUMAN_COLOR;
-          else
-            childSide = AI_COLOR;
-
-          GameMove* child = new GameMove(move, i, j, childSide);
-          int score = assessMove(child, levels-1, move->IsScoreAssigned(), move->GetScore());
-
-          if (move->GetSide() == AI_COLOR){
-            // minimizer
-
-            if (!move->IsScoreAssigned() || move->GetScore() > score){
-              move->SetScore(score);
-
-              // try alpha-beta, parent = maximizer
-              if (isAlphaBeta && alphaBetaExtremum >= move->GetScore()){
-                allBreak = true;
-              }
-            }
-          } else {
-            // maximizer
-            // parent= maximizer
-            if (!move->IsScoreAssigned() || move->GetScore() < score){
-              move->SetScore(score);
-
-              // try alpha-beta, parent = minimizer
-              if (isAlphaBeta && alphaBetaExtremum <= move->GetScore()){
-                allBreak = true;
-              }
-            }
+      // a reduced move that would become the best is searched again at full depth
+      if (reduced && (!move->IsScoreAssigned() || (isMinimizer ? score < move->GetScore() : score > move->GetScore()))){
+        child = new GameMove(move, c.row, c.col, childSide);
+        score = assessMove<Rules>(child, levels-1, move->IsScoreAssigned(), move->GetScore());
+      }
+
+      if (aborted)
+        break;
+
+      if (isMinimizer){
+        // minimizer
+
+        if (!move->IsScoreAssigned() || move->GetScore() > score){
+          move->SetScore(score);
+
+          // try alpha-beta, parent = maximizer
+          if (isAlphaBeta && alphaBetaExtremum >= move->GetScore()){
+            allBreak = true;
+          }
+        }
+      } else {
+        // maximizer
+        // parent= maximizer
+        if (!move->IsScoreAssigned() || move->GetScore() < score){
+          move->SetScore(score);
+
+          // try alpha-beta, parent = minimizer
+          if (isAlphaBeta && alphaBetaExtremum <= move->GetScore()){
+            allBreak = true;
           }
         }
       }
     }
 
     int max_score = move->GetScore();
+
+    // Unset the board
+    if (!isNullMove)
+      setCell(move->row, move->col, UNOCCUPIED);
     delete move;
     return max_score;
   }
 }
 
 
+/**
+ * Score a leaf where side has just played
+ * While either side has a four or an open three on the board, search the forcing replies until the
+ * position is quiet
+ */
+template<class Rules>
+int GameLogic::quiesce(char side, bool isAlphaBeta, int alphaBetaExtremum, short qDepth){
+  C5_TRACE_SCOPE("quiesce");
+  totalNodes++;
+  quiescenceCount++;
+  int standPat = evaluateBoard<Rules>();
+
+  // out of budget: the static score stands
+  if (qDepth >= searchParams.quiescenceDepth || quiescenceCount >= searchParams.quiescenceNodes)
+    return standPat;
+
+  char childSide = (side == AI_COLOR) ? HUMAN_COLOR : AI_COLOR;
+  bool isMinimizer = (side == AI_COLOR);
+
+  // threats pending anywhere on the board, whichever move made them
+  vector<CandidateMove> fiveCells[2];
+  bool three[2], five[2];
+  scanThreats<Rules>(fiveCells, three, five);
+  if (five[0] || five[1])
+    return standPat;
+  vector<CandidateMove>& ownFives = fiveCells[childSide == AI_COLOR];
+  vector<CandidateMove>& otherFives = fiveCells[side == AI_COLOR];
+
+  vector<CandidateMove> children;
+  bool four = false;
+  if (!ownFives.empty()){
+    // the side to move completes five
+    children.push_back(ownFives[0]);
+    four = true;
+  } else if (!otherFives.empty()){
+    // a four has to be blocked, on every cell that completes it
+    for (size_t k=0; k<otherFives.size(); k++){
+      if (!(Rules::HAS_FORBIDDEN && childSide == HUMAN_COLOR && isForbiddenMove(otherFives[k].row, otherFives[k].col)))
+        children.push_back(otherFives[k]);
+    }
+    four = true;
+  } else if (three[0] || three[1]){
+    // blocks and counter threats anywhere on the board
+    generateForcingMoves<Rules>(childSide, &children);
+  }
+  if (children.empty())
+    return standPat;
+
+  // the side to move has to answer a four, but may stand pat on the static score against a three
+  bool assigned = !four;
+  int best = standPat;
+  if (assigned && isAlphaBeta && (isMinimizer ? alphaBetaExtremum >= best : alphaBetaExtremum <= best))
+    return best;
+
+  for (size_t k=0; k<children.size() && quiescenceCount < searchParams.quiescenceNodes; k++){
+    CandidateMove& c = children[k];
+
+    setCell(c.row, c.col, childSide);
+    int score = quiesce<Rules>(childSide, assigned, best, qDepth+1);
+    setCell(c.row, c.col, UNOCCUPIED);
+
+    if (!assigned || (isMinimizer ? score < best : score > best)){
+      best = score;
+      assigned = true;
+
+      // alpha-beta against the parent, as in assessMove
+      if (isAlphaBeta && (isMinimizer ? alphaBetaExtremum >= best : alphaBetaExtremum <= best))
+        break;
+    }
+  }
+
+  return best;
+}
+
+
+/**
+ * Forcing moves for side anywhere on the board, most promising first
+ */
+template<class Rules>
+void GameLogic::generateForcingMoves(char side, vector<CandidateMove>* moves){
+  C5_TRACE_SCOPE("generateForcingMoves");
+
+  generateMoves<Rules>(side, moves);
+  size_t count = 0;
+  for (size_t k=0; k<moves->size(); k++){
+    if (!(*moves)[k].quiet)
+      (*moves)[count++] = (*moves)[k];
+  }
+  moves->resize(count);
+}
+
+
+/**
+ * Threats of both sides pending anywhere on the board, found run by run
+ */
+template<class Rules>
+void GameLogic::scanThreats(vector<CandidateMove>* fiveCells, bool* three, bool* five){
+  if (sparse != nullptr){
+    SparseCells cells = {sparse};
+    scanThreats<Rules>(cells, fiveCells, three, five);
+  } else {
+    DenseCells cells = {board, dimSize, stoneCells, stoneCount};
+    scanThreats<Rules>(cells, fiveCells, three, five);
+  }
+}
+
+
+template<class Rules, class Cells>
+void GameLogic::scanThreats(const Cells& cells, vector<CandidateMove>* fiveCells, bool* three, bool* five){
+  const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+  int numStones = cells.NumStones();
+
+  for (short s=0; s<2; s++){
+    fiveCells[s].clear();
+    three[s] = false;
+    five[s] = false;
+  }
+
+  for (int k=0; k<numStones; k++){
+    SparseStone stone = cells.Stone(k);
+    short row = stone.row, col = stone.col;
+    char side = stone.side;
+    short s = (side == AI_COLOR);
+    bool isBlack = (side == HUMAN_COLOR);
+
+    for (short d=0; d<4; d++){
+      short dirRow = DIRECTIONS[d][0], dirCol = DIRECTIONS[d][1];
+      // every run once, from its first stone
+      if (cells.OnBoard(row-dirRow, col-dirCol) && cells.At(row-dirRow, col-dirCol) == side)
+        continue;
+
+      short length = 1;
+      while (cells.OnBoard(row + length*dirRow, col + length*dirCol) && cells.At(row + length*dirRow, col + length*dirCol) == side)
+        length++;
+      if (Rules::IsWin(length, isBlack))
+        five[s] = true;
+      if (length == 3 && !three[s]){
+        short runLength = 0;
+        three[s] = (isBounded(cells, row, col, dirRow, dirCol, &runLength) == UNBOUNDED);
+      }
+
+      // the empty cell at either end of the run completes five with the run beyond it
+      for (short sign=-1; sign<=1; sign+=2){
+        short i = (sign > 0) ? row + length*dirRow : row - dirRow;
+        short j = (sign > 0) ? col + length*dirCol : col - dirCol;
+        if (!cells.OnBoard(i,j) || cells.At(i,j) != UNOCCUPIED)
+          continue;
+
+        short beyond = 0;
+        while (cells.OnBoard(i + sign*(beyond+1)*dirRow, j + sign*(beyond+1)*dirCol) &&
+               cells.At(i + sign*(beyond+1)*dirRow, j + sign*(beyond+1)*dirCol) == side)
+          beyond++;
+        if (!Rules::IsWin(length + 1 + beyond, isBlack))
+          continue;
+
+        bool listed = false;
+        for (size_t m=0; m<fiveCells[s].size() && !listed; m++)
+          listed = (fiveCells[s][m].row == i && fiveCells[s][m].col == j);
+        if (!listed){
+          CandidateMove c;
+          c.row = i;
+          c.col = j;
+          c.order = 0;
+          c.quiet = false;
+          fiveCells[s].push_back(c);
+        }
+      }
+    }
+  }
+}
+
+
+/**
+ * Sum of the absolute pattern scores through the stone at [row, col] in all four directions
+ * threat is set if the stone is part of a four or an open three
+ */
+template<class Rules>
+int GameLogic::assessStone(short row, short col, bool* threat, bool* five){
+  const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+  char side = cellAt(row, col);
+  int score = 0;
+
+  for (short d=0; d<4; d++){
+    short length = 0;
+    Boundedness boundedness = isBounded(row, col, DIRECTIONS[d][0], DIRECTIONS[d][1], &length);
+    score += abs(scoreFunction<Rules>(length, boundedness, side));
+
+    if ((length >= 4 && boundedness != BOUNDED) || (length == 3 && boundedness == UNBOUNDED))
+      (*threat) = true;
+    if (five != nullptr && Rules::IsWin(length, side == HUMAN_COLOR))
+      (*five) = true;
+  }
+
+  return score;
+}
+
+
+/**
+ * Admissible moves for side on the current board, most promising first
+ * A move is ordered by the patterns it makes for side plus the patterns it takes away from the opponent
+ */
+template<class Rules>
+void GameLogic::generateMoves(char side, vector<CandidateMove>* moves){
+  C5_TRACE_SCOPE("generateMoves");
+  char other = (side == AI_COLOR) ? HUMAN_COLOR : AI_COLOR;
+
+  admissibleCells(moves);
+  size_t count = 0;
+  for (size_t k=0; k<moves->size(); k++){
+    CandidateMove c = (*moves)[k];
+    bool ownThreat = false, otherThreat = false;
+
+    // forbidden moves of black are dropped as they are generated
+    if (Rules::HAS_FORBIDDEN && side == HUMAN_COLOR && isForbiddenMove(c.row, c.col))
+      continue;
+
+    // probe both colors on the cell
+    probeCell(c.row, c.col, side);
+    c.order = assessStone<Rules>(c.row, c.col, &ownThreat);
+    probeCell(c.row, c.col, other);
+    c.order += assessStone<Rules>(c.row, c.col, &otherThreat);
+    probeCell(c.row, c.col, UNOCCUPIED);
+
+    c.quiet = !ownThreat && !otherThreat;
+    (*moves)[count++] = c;
+  }
+  moves->resize(count);
+
+  stable_sort(moves->begin(), moves->end(), [](const CandidateMove& a, const CandidateMove& b){
+    return a.order > b.order;
+  });
+}
+
+
 /**
  * Assess a line in the board from [rowStart, colStart] in the direction of dirRow and dirCol
  * Return a score based on scoreFunction
  */
-int GameLogic::assessLine(short rowStart, short colStart, short dirRow, short dirCol){
+template<class Rules>
+int GameLogic::assessLine(short rowStart, short colStart, short dirRow, short dirCol, int* patternCounts){
   int score = 0;
   int i = rowStart, j = colStart;
 
+  // every run of a line without live windows is bounded: the line is shorter than five, or every
+  // five-cell stretch of it holds both colors
+  if (sparse == nullptr && !isLiveLine(rowStart, colStart, dirRow, dirCol))
+    return 0;
+
   while (i<dimSize && i>=0 && j<dimSize && j>=0){
     short ind = i*dimSize+j;
 
@@ -286,7 +714,10 @@ int GameLogic::assessLine(short rowStart, short colStart, short dirRow, short di
 
       short length = 0;
       Boundedness boundedness = isBounded(i, j, dirRow, dirCol, &length);
-      score += scoreFunction(length, boundedness, board[ind]);
+      score += scoreFunction<Rules>(length, boundedness, board[ind]);
+
+      if (patternCounts != nullptr && boundedness != BOUNDED)
+        patternCounts[EvalParams::Index(board[ind]==AI_COLOR, boundedness==UNBOUNDED, length)]++;
 
       // advance cursor by length
       i += dirRow*length;
@@ -304,34 +735,70 @@ int GameLogic::assessLine(short rowStart, short colStart, short dirRow, short di
 }
 
 
+/**
+ * Score the current board with the neural evaluator if loaded, otherwise with assessBoard
+ */
+template<class Rules>
+int GameLogic::evaluateBoard(){
+  C5_TRACE_SCOPE("evaluateBoard");
+  if (neural.IsLoaded())
+    return neural.Evaluate();
+
+  return assessBoard<Rules>();
+}
+
+
 /**
  * Assess the current board
  * Return a score based on scoreFunction
  */
-int GameLogic::assessBoard(){
+template<class Rules>
+int GameLogic::assessBoard(int* patternCounts){
   int score = 0;
 
+  if (sparse != nullptr){
+    // score every run once, from its first stone in each direction
+    const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+    for (int k=0; k<sparse->GetNumStones(); k++){
+      SparseStone stone = sparse->GetStone(k);
+      for (short d=0; d<4; d++){
+        short dirRow = DIRECTIONS[d][0], dirCol = DIRECTIONS[d][1];
+        if (onBoard(stone.row-dirRow, stone.col-dirCol) && cellAt(stone.row-dirRow, stone.col-dirCol) == stone.side)
+          continue;
+
+        short length = 0;
+        Boundedness boundedness = isBounded(stone.row, stone.col, dirRow, dirCol, &length);
+        score += scoreFunction<Rules>(length, boundedness, stone.side);
+
+        if (patternCounts != nullptr && boundedness != BOUNDED)
+          patternCounts[EvalParams::Index(stone.side==AI_COLOR, boundedness==UNBOUNDED, length)]++;
+      }
+    }
+
+    return score;
+  }
+
   // go through all rows, at col=0
   for (int i=0; i<dimSize; i++){
-    score += assessLine(i, 0, 0, 1);
+    score += assessLine<Rules>(i, 0, 0, 1, patternCounts);
   }
 
   // go through all columns
   for (int j=0; j<dimSize; j++){
     // do columns
-    score += assessLine(0, j, 1, 0);
+    score += assessLine<Rules>(0, j, 1, 0, patternCounts);
 
     // do negative diagonals
-    score += assessLine(0, j, 1, 1);
+    score += assessLine<Rules>(0, j, 1, 1, patternCounts);
     // do positive diagonals
-    score += assessLine(0, j, 1, -1);
+    score += assessLine<Rules>(0, j, 1, -1, patternCounts);
     
     // bottom row diagonals
     if (j>0 && j<dimSize-1){
       // do negative diagonal
-      score += assessLine(dimSize-1, j, -1, -1);
+      score += assessLine<Rules>(dimSize-1, j, -1, -1, patternCounts);
       // do positive diagonal
-      score += assessLine(dimSize-1, j, -1, 1);
+      score += assessLine<Rules>(dimSize-1, j, -1, 1, patternCounts);
     }
   }
 
@@ -346,18 +813,32 @@ int GameLogic::assessBoard(){
  */
 //FIXME: what about XX_XX
 GameLogic::Boundedness GameLogic::isBounded(short rowStart, short colStart, short dirRow, short dirCol, short* length){
+  if (sparse != nullptr){
+    SparseCells cells = {sparse};
+    return isBounded(cells, rowStart, colStart, dirRow, dirCol, length);
+  }
+  DenseCells cells = {board, dimSize, stoneCells, stoneCount};
+  return isBounded(cells, rowStart, colStart, dirRow, dirCol, length);
+}
+
+
+template<class Cells>
+GameLogic::Boundedness GameLogic::isBounded(const Cells& cells, short rowStart, short colStart, short dirRow, short dirCol, short* length){
+  // spaces beyond five on a side cannot change the classification, and bound the walk on unbounded boards
+  const short MAX_SPACE = 5;
   short spaceBefore = 0, spaceAfter = 0;
+  char side = cells.At(rowStart, colStart);
 
   // march in dirRow and dirCol
   short i=rowStart, j=colStart;
   bool flipped = false;
-  for (; i>=0 && i<dimSize && j>=0 && j<dimSize; i+=dirRow, j+=dirCol){
-    if (!flipped && board[i*dimSize+j] == board[rowStart*dimSize+colStart])
+  for (; cells.OnBoard(i,j) && spaceAfter < MAX_SPACE; i+=dirRow, j+=dirCol){
+    if (!flipped && cells.At(i,j) == side)
       (*length)++;
     else {
       flipped = true;
 
-      if (board[i*dimSize+j] == UNOCCUPIED)
+      if (cells.At(i,j) == UNOCCUPIED)
         spaceAfter++;
       else
         break;
@@ -367,13 +848,13 @@ GameLogic::Boundedness GameLogic::isBounded(short rowStart, short colStart, shor
   // march in opposite direction
   i=rowStart-dirRow; j=colStart-dirCol;
   flipped = false;
-  for (; i>=0 && i<dimSize && j>=0 && j<dimSize; i-=dirRow, j-=dirCol){
-    if (!flipped && board[i*dimSize+j] == board[rowStart*dimSize+colStart])
+  for (; cells.OnBoard(i,j) && spaceBefore < MAX_SPACE; i-=dirRow, j-=dirCol){
+    if (!flipped && cells.At(i,j) == side)
       (*length)++;
     else {
       flipped = true;
 
-      if (board[i*dimSize+j] == UNOCCUPIED)
+      if (cells.At(i,j) == UNOCCUPIED)
         spaceBefore++;
       else
         break;
@@ -394,43 +875,77 @@ GameLogic::Boundedness GameLogic::isBounded(short rowStart, short colStart, shor
  * Arbitrate whether a side has won depending on the moveRow and moveCol provided
  */
 GameLogic::Arbitration GameLogic::Arbitrate(char mySide){
+  if (rules == EXACT_FIVE_RULES)
+    return arbitrate<ExactFiveRules>(mySide);
+  else if (rules == RENJU_RULES)
+    return arbitrate<RenjuRules>(mySide);
+  return arbitrate<FreestyleRules>(mySide);
+}
+
+
+template<class Rules>
+GameLogic::Arbitration GameLogic::arbitrate(char mySide){
+  C5_TRACE_SCOPE("Arbitrate");
+  if (sparse != nullptr){
+    // measure every run of mySide from its first stone
+    const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+    for (int k=0; k<sparse->GetNumStones(); k++){
+      SparseStone stone = sparse->GetStone(k);
+      if (stone.side != mySide)
+        continue;
+
+      for (short d=0; d<4; d++){
+        short dirRow = DIRECTIONS[d][0], dirCol = DIRECTIONS[d][1];
+        if (onBoard(stone.row-dirRow, stone.col-dirCol) && cellAt(stone.row-dirRow, stone.col-dirCol) == mySide)
+          continue;
+
+        short count = 0;
+        for (short i=stone.row, j=stone.col; onBoard(i,j) && cellAt(i,j) == mySide; i+=dirRow, j+=dirCol)
+          count++;
+        if (Rules::IsWin(count, mySide == HUMAN_COLOR))
+          return WIN;
+      }
+    }
+
+    // an unbounded board is never full
+    if (dimSize != UNBOUNDED_SIZE && sparse->GetNumStones() == (int)dimSize*dimSize)
+      return DRAW;
+    return NONE;
+  }
+
   // go through all rows, at col=0
   for (int i=0; i<dimSize; i++){
-    if (isFiveConnected(i,0,0,1, mySide))
+    if (isFiveConnected<Rules>(i,0,0,1, mySide))
       return WIN;
   }
 
   // go through all columns
   for (int j=0; j<dimSize; j++){
     // do columns at row=0
-    if (isFiveConnected(0,j,1,0,mySide))
+    if (isFiveConnected<Rules>(0,j,1,0,mySide))
       return WIN;
 
     // do negative diagonals
-    if (isFiveConnected(0,j,1,1,mySide))
+    if (isFiveConnected<Rules>(0,j,1,1,mySide))
       return WIN;
     // do positive diagonals
-    if (isFiveConnected(0,j,1,-1,mySide))
+    if (isFiveConnected<Rules>(0,j,1,-1,mySide))
       return WIN;
     
     // bottom row diagonals
     if (j>0 && j<dimSize-1){
       // do negative diagonal
-      if (isFiveConnected(dimSize-1,j,-1,-1,mySide))
+      if (isFiveConnected<Rules>(dimSize-1,j,-1,-1,mySide))
         return WIN;
       // do positive diagonal
-      if (isFiveConnected(dimSize-1,j,-1,1,mySide))
+      if (isFiveConnected<Rules>(dimSize-1,j,-1,1,mySide))
         return WIN;
     }
   }
 
-  // check for empty cell
-  for (int i=0; i<dimSize; i++){
-    for (int j=0; j<dimSize; j++){
-      if (board[i*dimSize+j] == UNOCCUPIED)
-        return NONE;
-    }
-  }
+  // drawn as soon as no window can be completed by either side, a full board at the latest
+  if (hasOpenWindow())
+    return NONE;
 
   return DRAW;
 }
@@ -440,18 +955,20 @@ GameLogic::Arbitration GameLogic::Arbitrate(char mySide){
  * Evaluate whether the move is admissible
  * It's admissible only if it's not more than EXCEEDANCE moves away from other pieces AND the cell is unoccupied
  */
-bool GameLogic::isMoveAdmissible(short row, short col){
+bool GameLogic::isMoveAdmissible(short row, short col, bool liveOnly){
   const short EXCEEDANCE = 1;
 
-  if (board[row*dimSize + col] != UNOCCUPIED)
+  DenseCells cells = {board, dimSize, stoneCells, stoneCount};
+
+  if (cells.At(row, col) != UNOCCUPIED)
     return false;
 
   for (int i=row-EXCEEDANCE; i<=row+EXCEEDANCE; i++)
-    if (i>=0 && i<dimSize)
-      for (int j=col-EXCEEDANCE; j<=col+EXCEEDANCE; j++)
-        if (j>=0 && j<dimSize && board[i*dimSize+j]!=UNOCCUPIED)
-          return true;
-  
+    for (int j=col-EXCEEDANCE; j<=col+EXCEEDANCE; j++)
+      if (cells.OnBoard(i,j) && cells.At(i,j)!=UNOCCUPIED)
+        // a stone in no live window neither makes nor blocks a five
+        return !liveOnly || isLiveCell(row, col);
+
 
   return false;
 }
@@ -459,110 +976,674 @@ bool GameLogic::isMoveAdmissible(short row, short col){
 
 /**
  * Starting from startRow and startCol, check in the direction of dirRow and dirCol
- * If there are five consecutive pieces of color side, return true
+ * If there is a winning run of color side, return true
  */
+template<class Rules>
 bool GameLogic::isFiveConnected(short startRow, short startCol, short dirRow, short dirCol, char side){
   short i=startRow, j=startCol;
   short count = 0;
+  bool isBlack = (side == HUMAN_COLOR);
 
   for (; i >= 0 && i < dimSize && j >= 0 && j < dimSize; i+=dirRow, j+=dirCol){
-    if (board[i*dimSize+j] != side)
-      count = 0;
-    else
+    if (board[i*dimSize+j] == side){
       count++;
+      continue;
+    }
 
-    // winning condition: consecutive 5 pieces
-    if (count >= 5)
+    // winning condition: a run of consecutive pieces the rules accept, 5 or more in freestyle
+    if (Rules::IsWin(count, isBlack))
       return true;
+    count = 0;
   }
 
-  return false;
+  return Rules::IsWin(count, isBlack);
+}
+
+
+// cells on either side of the move examined by isForbiddenMove, and the codes of its line window
+#define FORBIDDEN_REACH  6
+#define WINDOW_EMPTY     0
+#define WINDOW_BLACK     1
+#define WINDOW_BLOCKED   2
+
+/**
+ * Cells of a line window where black completes exactly five through the centre
+ * Return their number, positions are stored in completions
+ */
+static short fiveCompletions(char* window, short* completions){
+  const short center = FORBIDDEN_REACH, size = 2*FORBIDDEN_REACH+1;
+  short count = 0;
+
+  for (short e=1; e<size-1; e++){
+    if (window[e] != WINDOW_EMPTY)
+      continue;
+
+    window[e] = WINDOW_BLACK;
+    short first = e, last = e;
+    while (first > 0 && window[first-1] == WINDOW_BLACK)
+      first--;
+    while (last < size-1 && window[last+1] == WINDOW_BLACK)
+      last++;
+    window[e] = WINDOW_EMPTY;
+
+    if (last-first+1 == 5 && first <= center && center <= last)
+      completions[count++] = e;
+  }
+
+  return count;
+}
+
+
+/**
+ * Whether black, having played the centre of window, may not play there under Renju rules:
+ * two threes, two fours or an overline, unless the move also makes exactly five
+ *
+ * A four is a window cell completing exactly five through the move. A three is a window cell making
+ * a straight four through the move, whose two completions are five cells apart. Threes are taken at
+ * face value, without checking that the move making the straight four would itself be allowed.
+ * Only the cells within FORBIDDEN_REACH of the move are read, so the check costs the same anywhere.
+ */
+bool GameLogic::isForbiddenMove(short row, short col){
+  if (sparse != nullptr){
+    SparseCells cells = {sparse};
+    return isForbiddenMove(cells, row, col);
+  }
+  DenseCells cells = {board, dimSize, stoneCells, stoneCount};
+  return isForbiddenMove(cells, row, col);
+}
+
+
+template<class Cells>
+bool GameLogic::isForbiddenMove(const Cells& cells, short row, short col){
+  const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+  const short center = FORBIDDEN_REACH, size = 2*FORBIDDEN_REACH+1;
+  char windows[4][2*FORBIDDEN_REACH+1];
+  short fours = 0, threes = 0;
+  bool overline = false;
+
+  for (short d=0; d<4; d++){
+    char* window = windows[d];
+    short blacks = 0;
+    for (short k=0; k<size; k++){
+      short i = row + (k-center)*DIRECTIONS[d][0], j = col + (k-center)*DIRECTIONS[d][1];
+      char cell = (k == center) ? HUMAN_COLOR : (cells.OnBoard(i,j) ? cells.At(i,j) : AI_COLOR);
+      window[k] = (cell == HUMAN_COLOR) ? WINDOW_BLACK : ((cell == UNOCCUPIED) ? WINDOW_EMPTY : WINDOW_BLOCKED);
+      if (cell == HUMAN_COLOR && k != center && k >= center-4 && k <= center+4)
+        blacks++;
+    }
+
+    // length of the run through the move
+    short first = center, last = center;
+    while (first > 0 && window[first-1] == WINDOW_BLACK)
+      first--;
+    while (last < size-1 && window[last+1] == WINDOW_BLACK)
+      last++;
+
+    // making five is always allowed
+    if (last-first+1 == 5)
+      return false;
+    if (last-first+1 > 5)
+      overline = true;
+
+    // a four needs three more black stones within reach, a three two
+    short completions[2*FORBIDDEN_REACH+1];
+    if (blacks >= 3){
+      short n = fiveCompletions(window, completions);
+      fours += n;
+      // the two completions of a straight four belong to the same four
+      for (short a=0; a<n; a++)
+        for (short b=a+1; b<n; b++)
+          if (completions[b]-completions[a] == 5)
+            fours--;
+    }
+
+    if (blacks >= 2){
+      bool three = false;
+      for (short e=center-4; e<=center+4 && !three; e++){
+        if (window[e] != WINDOW_EMPTY)
+          continue;
+
+        window[e] = WINDOW_BLACK;
+        short n = fiveCompletions(window, completions);
+        for (short a=0; a<n && !three; a++)
+          for (short b=a+1; b<n && !three; b++)
+            three = (completions[b]-completions[a] == 5);
+        window[e] = WINDOW_EMPTY;
+      }
+      if (three)
+        threes++;
+    }
+  }
+
+  return overline || fours >= 2 || threes >= 2;
 }
 
 
 /**
  * Assign a score of the current combination based on boundedness, length of continuous colors and
- * the color of the player (human or AI)
+ * the color of the player (human or AI), looked up in params
  */
+template<class Rules>
 int GameLogic::scoreFunction(short length, Boundedness boundedness, char side){
   // guard against non-sensical inputs
   if (side == UNOCCUPIED)
     return 0;
 
-  // guard against negative length
-  length = (length>0)?length:0;
+  // both sides bounded
+  if (boundedness == BOUNDED)
+    return 0;
 
-  if (boundedness == BOUNDED){
-    // both sides bounded
+  // an overline that does not win is dead
+  if (length > 5 && !Rules::IsWin(length, side == HUMAN_COLOR))
     return 0;
 
-  } else if (boundedness == UNBOUNDED){
-    // both sides unbounded
-
-    if (side == HUMAN_COLOR){
-      // human color
-      if (length < 2)
-        return -length*3;
-      else if (length == 2)
-        return -50;
-      else if (length == 3)
-        return -150;
-      else if (length == 4)
-        return -500;
-      else
-        return -4000;
-    } else {
-      // AI color
-      if (length < 2)
-        return length*2;
-      else if (length == 2)
-        return 40;
-      else if (length == 3)
-        return 90;
-      else if (length == 4)
-        return 300;
-      else
-        return 4000;
+  // non-positive lengths score 0
+  return params.Score(side == AI_COLOR, boundedness == UNBOUNDED, length);
+}
+
+
+void GameLogic::SetBoardSize(short _dim){
+  releaseBoard();
+  dimSize = _dim;
+  allocateBoard();
+
+  delete mcts;
+  mcts = nullptr;
+  delete solver;
+  solver = nullptr;
+  if (solved.GetDimSize() != dimSize)
+    solved.Reset(0, FREESTYLE_RULES);
+
+  // the network is trained for a single board size
+  if (neural.IsLoaded()){
+    if (neural.GetDimSize() == dimSize)
+      neural.Reset();
+    else
+      neural.Unload();
+  }
+}
+
+void GameLogic::SetRules(RuleVariant _rules){
+  rules = _rules;
+}
+
+RuleVariant GameLogic::GetRules(){
+  return rules;
+}
+
+void GameLogic::SetDifficulty(short _diff){
+  difficulty = _diff;
+}
+
+short GameLogic::GetDifficulty(){
+  return difficulty;
+}
+
+void GameLogic::SetSearchDepth(short _depth){
+  searchDepth = _depth;
+}
+
+void GameLogic::SetSearchParams(const SearchParams& _params){
+  searchParams = _params;
+}
+
+unsigned int GameLogic::GetNodeCount(){
+  return totalNodes;
+}
+
+int GameLogic::GetPlayoutCount(){
+  return playouts;
+}
+
+int GameLogic::GetTreeNodeCount(){
+  return treeNodes;
+}
+
+void GameLogic::SetMoveTime(int _ms){
+  moveTime = _ms;
+}
+
+void GameLogic::SetThreads(short _threads){
+  threads = _threads;
+}
+
+bool GameLogic::SetTraceFile(const char* prefix){
+#ifdef CONNECTFIVE_TRACE
+  tracePrefix = (prefix == nullptr) ? "" : prefix;
+  return true;
+#else
+  (void)prefix;
+  return false;
+#endif
+}
+
+void GameLogic::BeginTrace(){
+#ifdef CONNECTFIVE_TRACE
+  traceStart = Trace::Now();
+#endif
+}
+
+bool GameLogic::ExportTrace(const char* path){
+#ifdef CONNECTFIVE_TRACE
+  return path != nullptr && Trace::Export(path, traceStart);
+#else
+  (void)path;
+  return false;
+#endif
+}
+
+
+void GameLogic::SetEvalParams(const EvalParams& _params){
+  params = _params;
+}
+
+
+/**
+ * Replace the board with cells, dimSize*dimSize characters row by row
+ * Return false, leaving the board untouched, if cells is malformed
+ */
+bool GameLogic::SetPosition(const char* cells){
+  if (sparse != nullptr)
+    return false;
+
+  short numCells = dimSize*dimSize;
+
+  for (short ind=0; ind<numCells; ind++){
+    if (cells[ind] != '.' && cells[ind] != HUMAN_COLOR && cells[ind] != AI_COLOR)
+      return false;
+  }
+  if (cells[numCells] != '\0')
+    return false;
+
+  for (short ind=0; ind<numCells; ind++)
+    setCell(ind/dimSize, ind%dimSize, (cells[ind] == '.') ? UNOCCUPIED : cells[ind]);
+
+  return true;
+}
+
+
+/**
+ * Count the scored patterns on the current board, counts is indexed by EvalParams::Index
+ */
+void GameLogic::CountPatterns(int* counts){
+  for (short k=0; k<EvalParams::NUM_PARAMS; k++)
+    counts[k] = 0;
+
+  if (rules == EXACT_FIVE_RULES)
+    assessBoard<ExactFiveRules>(counts);
+  else if (rules == RENJU_RULES)
+    assessBoard<RenjuRules>(counts);
+  else
+    assessBoard<FreestyleRules>(counts);
+}
+
+
+/**
+ * Use the neural network at path instead of assessBoard to score positions in the search
+ * Return false if the weights cannot be loaded for the current board size
+ */
+bool GameLogic::LoadNeuralWeights(const char* path){
+  // the network has one input per cell
+  if (sparse != nullptr || !neural.Load(path, dimSize))
+    return false;
+
+  // bring the accumulator up to the current position
+  for (short ind=0; ind<dimSize*dimSize; ind++){
+    if (board[ind] != UNOCCUPIED)
+      neural.AddStone(ind, board[ind]);
+  }
+
+  return true;
+}
+
+
+void GameLogic::UnloadNeuralWeights(){
+  neural.Unload();
+}
+
+
+bool GameLogic::LoadSolvedTable(const char* path){
+  SolvedTable table;
+  if (sparse != nullptr || !table.Load(path) || table.GetDimSize() != dimSize)
+    return false;
+
+  solved = table;
+  return true;
+}
+
+
+void GameLogic::UnloadSolvedTable(){
+  solved.Reset(0, FREESTYLE_RULES);
+}
+
+
+/**
+ * Look the position up in the solved table, solve it outright if the table misses it, then
+ * search for a win by fours
+ */
+bool GameLogic::FindSolvedMove(short *row, short *col){
+  C5_TRACE_SCOPE("FindSolvedMove");
+  if (sparse != nullptr || rules == RENJU_RULES)
+    return false;
+
+  ProofOutcome outcome;
+  bool hasTable = (solved.GetSize() > 0 && solved.GetRules() == rules);
+  if (hasTable && solved.Lookup(ProofSolver::PositionKey(board, dimSize, AI_COLOR), &outcome) &&
+      outcome.row >= 0 && outcome.row < dimSize && outcome.col >= 0 && outcome.col < dimSize &&
+      cellAt(outcome.row, outcome.col) == UNOCCUPIED){
+    (*row) = outcome.row;
+    (*col) = outcome.col;
+    return true;
+  }
+
+  if (!hasTable && !searchParams.threatProof)
+    return false;
+
+  if (solver == nullptr)
+    solver = new ProofSolver(dimSize, PROOF_TABLE_BITS);
+  solver->SetRules(rules);
+  totalNodes = 0;
+
+  // a table marks a board small enough to be solved, the positions it misses are solved here
+  if (hasTable){
+    outcome = solver->Solve(board, AI_COLOR, searchParams.proofNodes);
+    totalNodes += solver->GetNodeCount();
+    if (outcome.result != PROOF_UNKNOWN && outcome.row >= 0){
+      (*row) = outcome.row;
+      (*col) = outcome.col;
+      return true;
+    }
+  }
+
+  if (!searchParams.threatProof)
+    return false;
+
+  outcome = solver->SolveThreats(board, AI_COLOR, searchParams.proofNodes);
+  totalNodes += solver->GetNodeCount();
+  if (outcome.result != PROOF_WIN)
+    return false;
+
+  (*row) = outcome.row;
+  (*col) = outcome.col;
+  return true;
+}
+
+
+/**
+ * Place side (or UNOCCUPIED) at [row, col]
+ * All board changes go through here so that incremental evaluators stay in sync
+ */
+void GameLogic::setCell(short row, short col, char side){
+  if (sparse != nullptr){
+    sparse->Set(row, col, side);
+    return;
+  }
+
+  short ind = row*dimSize+col;
+  if (neural.IsLoaded()){
+    if (board[ind] != UNOCCUPIED)
+      neural.RemoveStone(ind, board[ind]);
+    if (side != UNOCCUPIED)
+      neural.AddStone(ind, side);
+  }
+
+  if (board[ind] != UNOCCUPIED)
+    updateWindows(row, col, board[ind], -1);
+  if (side != UNOCCUPIED)
+    updateWindows(row, col, side, 1);
+
+  if (board[ind] == UNOCCUPIED && side != UNOCCUPIED){
+    stoneSlots[ind] = stoneCount;
+    stoneCells[stoneCount++] = ind;
+  } else if (board[ind] != UNOCCUPIED && side == UNOCCUPIED){
+    short last = stoneCells[--stoneCount];
+    stoneCells[stoneSlots[ind]] = last;
+    stoneSlots[last] = stoneSlots[ind];
+  }
+
+  board[ind] = side;
+}
+
+
+/**
+ * Add delta stones of side at [row, col] to the windows through it
+ */
+void GameLogic::updateWindows(short row, short col, char side, short delta){
+  int ind = row*dimSize + col;
+
+  // stores through the uint8_t array may alias the members, so the loop works on copies
+  uint8_t* stones = windowStones[side == AI_COLOR];
+  const uint16_t* windows = cellWindows + WINDOWS_PER_CELL*ind;
+  short numWindows = numCellWindows[ind];
+
+  for (short k=0; k<numWindows; k++)
+    stones[windows[k]] += delta;
+}
+
+
+/**
+ * Whether a window through the empty cell [row, col] can still be completed by a side
+ */
+bool GameLogic::isLiveCell(short row, short col){
+  int ind = row*dimSize + col;
+  const uint16_t* windows = cellWindows + WINDOWS_PER_CELL*ind;
+
+  for (short k=0; k<numCellWindows[ind]; k++){
+    if (windowStones[0][windows[k]] == 0 || windowStones[1][windows[k]] == 0)
+      return true;
+  }
+  return false;
+}
+
+
+/**
+ * Whether a window of the line from [rowStart, colStart] along [dirRow, dirCol] holds a single color
+ */
+bool GameLogic::isLiveLine(short rowStart, short colStart, short dirRow, short dirCol){
+  // windows are stored from their first cell along {0,1}, {1,0}, {1,1} or {1,-1}
+  if (dirRow < 0){
+    rowStart += (dimSize-1)*dirRow;
+    colStart += (dimSize-1)*dirCol;
+    dirRow = -dirRow;
+    dirCol = -dirCol;
+    // back onto the board along the line
+    int excess = max(max(-rowStart, -colStart), colStart - (dimSize-1));
+    if (excess > 0){
+      rowStart += excess;
+      colStart += excess*dirCol;
     }
   }
+  short d = (dirRow == 0) ? 0 : (dirCol == 0) ? 1 : (dirCol > 0) ? 2 : 3;
+  const uint8_t* black = windowStones[0] + d*dimSize*dimSize;
+  const uint8_t* white = windowStones[1] + d*dimSize*dimSize;
+
+  DenseCells cells = {board, dimSize, stoneCells, stoneCount};
+  for (short i=rowStart, j=colStart; cells.OnBoard(i + 4*dirRow, j + 4*dirCol); i+=dirRow, j+=dirCol){
+    int w = i*dimSize + j;
+    if (black[w] == 0 || white[w] == 0)
+      return true;
+  }
+  return false;
+}
 
-  else {
-    // one side bounded
 
-    if (side == HUMAN_COLOR){
-      // human color
-      if (length <= 2)
-        return -length;
-      else if (length == 3)
-        return -20;
-      else if (length == 4)
-        return -400;
-      else
-        return -4000;
-    } else {
-      // AI color
-      if (length <= 2)
-        return length;
-      else if (length == 3)
-        return 15;
-      else if (length == 4)
-        return 150;
-      else
-        return 4000;
+/**
+ * Whether a window of the board can still be completed by a side
+ */
+bool GameLogic::hasOpenWindow(){
+  int numWindows = 4*dimSize*dimSize;
+  const uint8_t* black = windowStones[0];
+  const uint8_t* white = windowStones[1];
+
+  for (int w=0; w<numWindows; w++){
+    if ((black[w] == 0 && white[w] < 5) || (white[w] == 0 && black[w] < 5))
+      return true;
+  }
+  return false;
+}
+
+
+/**
+ * Window counts of the empty dense board
+ */
+void GameLogic::resetWindows(){
+  const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+  int numCells = dimSize*dimSize;
+
+  // windows running off the board hold both colors, so that they are never open
+  memset(windowStones[0], 1, 4*numCells);
+  memset(windowStones[1], 1, 4*numCells);
+  memset(numCellWindows, 0, numCells);
+
+  for (short d=0; d<4; d++){
+    short dirRow = DIRECTIONS[d][0], dirCol = DIRECTIONS[d][1];
+    for (short i=0; i<dimSize; i++){
+      for (short j=0; j<dimSize; j++){
+        if (!onBoard(i + 4*dirRow, j + 4*dirCol))
+          continue;
+
+        windowStones[0][d*numCells + i*dimSize + j] = 0;
+        windowStones[1][d*numCells + i*dimSize + j] = 0;
+        for (short m=0; m<5; m++){
+          short ind = (i + m*dirRow)*dimSize + j + m*dirCol;
+          cellWindows[WINDOWS_PER_CELL*ind + numCellWindows[ind]++] = (uint16_t)(d*numCells + i*dimSize + j);
+        }
+      }
     }
   }
 }
 
 
-void GameLogic::SetBoardSize(short _dim){
-  dimSize = _dim;
+/**
+ * Write side at [row, col] without updating the evaluators, for probes that evaluate no position
+ */
+void GameLogic::probeCell(short row, short col, char side){
+  if (sparse != nullptr)
+    sparse->Probe(row, col, side);
+  else
+    board[row*dimSize+col] = side;
+}
 
-  deleteBoard(board);
-  newBoard(&board);
+
+/**
+ * Number of stones on the board
+ */
+int GameLogic::countStones(){
+  if (sparse != nullptr)
+    return sparse->GetNumStones();
+  return stoneCount;
 }
 
-void GameLogic::SetDifficulty(short _diff){
-  difficulty = _diff;
+
+bool GameLogic::onBoard(int row, int col){
+  if (sparse != nullptr)
+    return sparse->OnBoard(row, col);
+
+  return row >= 0 && row < dimSize && col >= 0 && col < dimSize;
+}
+
+
+char GameLogic::cellAt(short row, short col){
+  if (sparse != nullptr)
+    return sparse->Get(row, col);
+
+  return board[row*dimSize+col];
+}
+
+
+/**
+ * Admissible moves on the current board in (row, col) order, with order = 0
+ * The dense board is scanned, the sparse board only visits the neighbours of its stones
+ */
+void GameLogic::admissibleCells(vector<CandidateMove>* cells){
+  C5_TRACE_SCOPE("admissibleCells");
+  CandidateMove c;
+  c.order = 0;
+  c.quiet = true;
+  cells->clear();
+
+  if (sparse == nullptr){
+    // dead cells are left out, unless all of them are dead and the game is drawn anyway
+    for (short pass=0; pass<2 && cells->empty(); pass++){
+      for (short i=0; i<dimSize; i++){
+        for (short j=0; j<dimSize; j++){
+          if (isMoveAdmissible(i, j, pass == 0)){
+            c.row = i;
+            c.col = j;
+            cells->push_back(c);
+          }
+        }
+      }
+    }
+    return;
+  }
+
+  for (int k=0; k<sparse->GetNumStones(); k++){
+    SparseStone stone = sparse->GetStone(k);
+    for (short i=stone.row-1; i<=stone.row+1; i++){
+      for (short j=stone.col-1; j<=stone.col+1; j++){
+        if (onBoard(i,j) && cellAt(i,j) == UNOCCUPIED){
+          c.row = i;
+          c.col = j;
+          cells->push_back(c);
+        }
+      }
+    }
+  }
+
+  sort(cells->begin(), cells->end(), [](const CandidateMove& a, const CandidateMove& b){
+    return a.row < b.row || (a.row == b.row && a.col < b.col);
+  });
+  cells->erase(unique(cells->begin(), cells->end(), [](const CandidateMove& a, const CandidateMove& b){
+    return a.row == b.row && a.col == b.col;
+  }), cells->end());
+}
+
+
+/**
+ * Use sparse storage for unbounded boards and boards larger than MAX_DENSE_SIZE
+ */
+void GameLogic::allocateBoard(){
+  if (dimSize == UNBOUNDED_SIZE || dimSize > MAX_DENSE_SIZE){
+    sparse = new SparseBoard(dimSize);
+    board = nullptr;
+    windowStones[0] = windowStones[1] = nullptr;
+    cellWindows = nullptr;
+    numCellWindows = nullptr;
+    stoneCells = stoneSlots = nullptr;
+  } else {
+    sparse = nullptr;
+    newBoard(&board);
+
+    int numCells = dimSize*dimSize;
+    stoneCells = new short[numCells];
+    stoneSlots = new short[numCells];
+    windowStones[0] = new uint8_t[4*numCells];
+    windowStones[1] = new uint8_t[4*numCells];
+    cellWindows = new uint16_t[WINDOWS_PER_CELL*numCells];
+    numCellWindows = new uint8_t[numCells];
+    resetWindows();
+  }
+  stoneCount = 0;
+}
+
+
+void GameLogic::releaseBoard(){
+  delete sparse;
+  sparse = nullptr;
+  deleteBoard(board);
+  board = nullptr;
+
+  delete [] windowStones[0];
+  delete [] windowStones[1];
+  delete [] cellWindows;
+  delete [] numCellWindows;
+  delete [] stoneCells;
+  delete [] stoneSlots;
+  windowStones[0] = windowStones[1] = nullptr;
+  cellWindows = nullptr;
+  numCellWindows = nullptr;
+  stoneCells = stoneSlots = nullptr;
 }
 
 
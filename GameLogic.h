@@ -1,12 +1,32 @@
 #ifndef RULES_H
 #define RULES_H
 
+#include <stdint.h>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
 #include "GameMove.h"
+#include "NeuralEvaluator.h"
+#include "ProofSolver.h"
+#include "SolvedTable.h"
+#include "EvalParams.h"
+#include "MCTSEngine.h"
+#include "SearchParams.h"
+#include "SparseBoard.h"
+#include "RuleVariants.h"
 
 #define UNOCCUPIED    '\0'
 #define HUMAN_COLOR   'B'
 #define AI_COLOR      'W'
 
+// board size of an unbounded board
+#define UNBOUNDED_SIZE  0
+// larger boards are stored sparsely
+#define MAX_DENSE_SIZE  64
+// row of a null move (pass) or of no move, outside the coordinates of any board including unbounded ones
+#define NULL_MOVE_ROW   (-SparseBoard::LIMIT-1)
+
 class GameLogic
 {
 public:
@@ -14,22 +34,33 @@ public:
   ~GameLogic(void);
 
   /**
-   * Print board to stdio
+   * Print board to out
    */
-  void PrintBoard();
+  void PrintBoard(std::ostream& out);
   /**
    * Human player set move
    * i = row, j = col
    * Return true if it's a valid move
    */
   bool SetMove(short i, short j);
+  /**
+   * Place a stone of side (HUMAN_COLOR or AI_COLOR) at [row, col]
+   * Return true if it's a valid move
+   */
+  bool PlayMove(short row, short col, char side);
   /**
    * AI player set move
-   * The move made is stored in row and col
+   * The move made is stored in row and col, false if there was no move to play
    */
-  void AIMakeMove(short *row, short *col);
+  bool AIMakeMove(short *row, short *col);
+  /**
+   * Find the move AIMakeMove would make, without playing it
+   * The centre is returned on an empty board, false if the board is full
+   */
+  bool FindAIMove(short *row, short *col);
   /**
    * Arbitrate whether a side has won depending on the moveRow and moveCol provided
+   * On boards up to MAX_DENSE_SIZE the game is drawn as soon as no five can be completed
    */
   enum Arbitration {
     WIN,
@@ -38,12 +69,129 @@ public:
   };
   Arbitration Arbitrate(char side);
 
+  /**
+   * Rules of the game, freestyle by default
+   * Under Renju the human plays black: SetMove rejects its forbidden moves
+   * The Monte Carlo tree search plays freestyle only: under exact-five and Renju rules difficulty 3
+   * plays minimax to the search depth instead
+   */
+  void SetRules(RuleVariant _rules);
+  RuleVariant GetRules();
+
+  /**
+   * 1 = greedy, 2 = minimax, 3 = Monte Carlo tree search
+   * Difficulty 3 falls back to minimax on sparse boards and under rules other than freestyle
+   */
   void SetDifficulty(short _diff);
+  short GetDifficulty();
+  /**
+   * _dim = UNBOUNDED_SIZE for an unbounded board
+   * Unbounded boards and boards above MAX_DENSE_SIZE are stored sparsely; they are played with
+   * minimax at difficulty 3 and without the neural evaluator
+   */
   void SetBoardSize(short _dim);
 
+  /**
+   * Time per move and number of threads of the Monte Carlo tree search
+   * threads = 0 uses every hardware thread
+   */
+  void SetMoveTime(int _ms);
+  void SetThreads(short _threads);
+
+  /**
+   * Use the neural network at path instead of assessBoard to score positions in the search
+   * Return false if the weights cannot be loaded for the current board size
+   */
+  bool LoadNeuralWeights(const char* path);
+  void UnloadNeuralWeights();
+
+  /**
+   * Play the moves of the solved positions in the table at path, made by tools/SolveTable.cpp
+   * Return false if the table cannot be loaded or was made for another board size
+   */
+  bool LoadSolvedTable(const char* path);
+  void UnloadSolvedTable();
+
+  /**
+   * Move for the AI from the solved table, or else its forced win by fours if one is proven
+   * within SearchParams::proofNodes positions. With a table loaded, positions it misses are
+   * first solved outright within the same budget. FindAIMove plays it at difficulties 2 and 3
+   * Return false if there is none, always on sparse boards and under Renju
+   */
+  bool FindSolvedMove(short *row, short *col);
+
+  /**
+   * Replace the pattern weights used by scoreFunction
+   */
+  void SetEvalParams(const EvalParams& _params);
+
+  /**
+   * Replace the board with cells, dimSize*dimSize characters row by row
+   * '.' = unoccupied, HUMAN_COLOR or AI_COLOR
+   * Return false, leaving the board untouched, if cells is malformed or the board is sparse
+   */
+  bool SetPosition(const char* cells);
+
+  /**
+   * Count the scored patterns on the current board, counts is indexed by EvalParams::Index
+   * assessBoard() is the dot product of these counts with the pattern weights
+   */
+  void CountPatterns(int* counts);
+
+  /**
+   * Minimax settings: plies searched below each root move at difficulty 2, and selective search
+   */
+  void SetSearchDepth(short _depth);
+  void SetSearchParams(const SearchParams& _params);
+
+  /**
+   * Find the best AI move with minimax to depth plies beneath each root move, without playing it
+   * timeLimitMs > 0 aborts the search once exceeded, in which case false is returned and the
+   * move is meaningless. False is also returned if there is no move to search
+   */
+  bool SearchBestMove(short depth, int timeLimitMs, short *row, short *col);
+
+  /**
+   * Statistics of the last search: positions evaluated by the greedy or minimax search,
+   * playouts and tree nodes of the Monte Carlo tree search
+   */
+  unsigned int GetNodeCount();
+  int GetPlayoutCount();
+  int GetTreeNodeCount();
+
+  /**
+   * Export a Chrome trace of every AIMakeMove to <prefix>-<move number>.json, null to stop
+   * Return false if tracing is not compiled in, see Trace.h
+   */
+  bool SetTraceFile(const char* prefix);
+  /**
+   * Trace session: ExportTrace writes the spans recorded since BeginTrace to path as a Chrome
+   * trace, and returns false if tracing is not compiled in or path cannot be written.
+   * Spans are not tagged by engine, so the trace holds those of every engine of the process.
+   * Only BeginTrace moves the start, AIMakeMove exports from a start of its own
+   */
+  void BeginTrace();
+  bool ExportTrace(const char* path);
+
 private:
   short dimSize;
   short difficulty;
+  RuleVariant rules;
+
+  /**
+   * Monte Carlo tree search, created on first use at difficulty 3
+   * It is advanced on every move so that its tree is reused between turns
+   */
+  MCTSEngine* mcts;
+  int moveTime;
+  short threads;
+
+  /**
+   * Start of the BeginTrace session, and the export after each AIMakeMove
+   */
+  int64_t traceStart;
+  std::string tracePrefix;
+  int traceCount;
 
   /**
    * Storage for board moves
@@ -54,10 +202,97 @@ private:
   void deleteBoard(char* _board);
   void newBoard(char** _board);
 
+  /**
+   * Storage of unbounded and very large boards, board is null when it is used
+   */
+  SparseBoard* sparse;
+  void allocateBoard();
+  void releaseBoard();
+
+  /**
+   * Occupied cells of the dense board in no particular order, kept up to date by setCell like the
+   * stone list of SparseBoard: the last cell of the list takes the slot of a removed one
+   */
+  short* stoneCells;
+  // slot of each occupied cell in stoneCells
+  short* stoneSlots;
+  short stoneCount;
+
+  /**
+   * Five-cell windows of the dense board, kept up to date by setCell
+   * A window is dead once it holds stones of both colors, and open while it can still be completed
+   * by a side. Move generation skips cells without a live window and arbitration calls a draw once
+   * no window is open. Evaluation only skips whole lines without one, not dead stretches of a line
+   */
+  // [color][direction*dimSize*dimSize + first cell of the window], AI_COLOR second
+  uint8_t* windowStones[2];
+  // the windows through each cell, by index into windowStones
+  uint16_t* cellWindows;
+  uint8_t* numCellWindows;
+  void resetWindows();
+  void updateWindows(short row, short col, char side, short delta);
+  bool isLiveCell(short row, short col);
+  bool isLiveLine(short rowStart, short colStart, short dirRow, short dirCol);
+  bool hasOpenWindow();
+
+  /**
+   * Cell access on either storage
+   */
+  int countStones();
+  bool onBoard(int row, int col);
+  char cellAt(short row, short col);
+
+  /**
+   * Cell access on one storage, for the loops that are compiled once per storage and pick it once
+   * per call instead of once per cell
+   */
+  struct DenseCells {
+    const char* board;
+    short dimSize;
+    const short* stoneCells;
+    short stoneCount;
+    bool OnBoard(int row, int col) const { return row >= 0 && row < dimSize && col >= 0 && col < dimSize; }
+    char At(short row, short col) const { return board[row*dimSize+col]; }
+    int NumStones() const { return stoneCount; }
+    SparseStone Stone(int k) const {
+      SparseStone stone = {(short)(stoneCells[k] / dimSize), (short)(stoneCells[k] % dimSize), board[stoneCells[k]]};
+      return stone;
+    }
+  };
+  struct SparseCells {
+    SparseBoard* sparse;
+    bool OnBoard(int row, int col) const { return sparse->OnBoard(row, col); }
+    char At(short row, short col) const { return sparse->Get(row, col); }
+    int NumStones() const { return sparse->GetNumStones(); }
+    SparseStone Stone(int k) const { return sparse->GetStone(k); }
+  };
+
+  /**
+   * Place side (or UNOCCUPIED) at [row, col]
+   * All board changes go through here so that incremental evaluators stay in sync
+   */
+  void setCell(short row, short col, char side);
+  /**
+   * Write side at [row, col] without updating the evaluators, for probes that evaluate no position
+   */
+  void probeCell(short row, short col, char side);
+
+  /**
+   * Optional neural evaluator, used when loaded
+   */
+  NeuralEvaluator neural;
+
+  /**
+   * Solved positions, and the proof-number search for forced wins, created on first use
+   */
+  SolvedTable solved;
+  ProofSolver* solver;
+
   /**
    * Starting from startRow and startCol, check in the direction of dirRow and dirCol
-   * If there are five consecutive pieces of color side, return true
+   * If there is a winning run of color side, return true
    */
+  template<class Rules>
   bool isFiveConnected(short startRow, short startCol, short dirRow, short dirCol, char side);
 
   /**
@@ -69,35 +304,137 @@ private:
     ONE_SIDED
   };
   Boundedness isBounded(short rowStart, short colBegin, short dirRow, short dirCol, short* length);
+  template<class Cells>
+  Boundedness isBounded(const Cells& cells, short rowStart, short colBegin, short dirRow, short dirCol, short* length);
 
   /**
    * Assign a score of the current combination based on boundedness, length of continuous colors and
-   * the color of the player (human or AI)
+   * the color of the player (human or AI), looked up in params
    */
+  EvalParams params;
+  template<class Rules>
   int scoreFunction(short length, Boundedness boundedness, char side);
 
   /**
    * Assess a line in the board from [rowStart, colStart] in the direction of dirRow and dirCol
    * Return a score based on scoreFunction
+   * If patternCounts is given, also count every scored pattern in it
    */
-  int assessLine(short rowStart, short colStart, short dirRow, short dirCol);
+  template<class Rules>
+  int assessLine(short rowStart, short colStart, short dirRow, short dirCol, int* patternCounts = nullptr);
   /**
    * Assess the current board
    * Return a score based on scoreFunction
    */
-  int assessBoard();
+  template<class Rules>
+  int assessBoard(int* patternCounts = nullptr);
+  /**
+   * Score the current board with the neural evaluator if loaded, otherwise with assessBoard
+   */
+  template<class Rules>
+  int evaluateBoard();
 
   /**
-   * Evaluate whether the move is admissible
+   * Evaluate whether the move is admissible on the dense board: an empty cell next to a stone
+   * liveOnly also requires a live window through it
    */
-  bool isMoveAdmissible(short row, short col);
+  bool isMoveAdmissible(short row, short col, bool liveOnly);
+
+  /**
+   * Whether black (HUMAN_COLOR) may not play [row, col] under Renju rules, see RenjuRules
+   * Recomputed from the lines through the cell on every call, only black's candidates need it
+   */
+  bool isForbiddenMove(short row, short col);
+  template<class Cells>
+  bool isForbiddenMove(const Cells& cells, short row, short col);
+
+  /**
+   * Implementations of FindAIMove, SearchBestMove and Arbitrate for the rules policy Rules
+   * The search and evaluation below are instantiated once per rule variant. findAIMove only runs
+   * the Monte Carlo tree search for FreestyleRules on a dense board, minimax otherwise
+   */
+  template<class Rules>
+  bool findAIMove(short *row, short *col);
+  template<class Rules>
+  bool searchBestMove(short depth, int timeLimitMs, short *row, short *col);
+  template<class Rules>
+  Arbitration arbitrate(char side);
+
+  /**
+   * Sum of the absolute pattern scores through the stone at [row, col] in all four directions
+   * threat is set if the stone is part of a four or an open three, five if it is part of five or more
+   */
+  template<class Rules>
+  int assessStone(short row, short col, bool* threat, bool* five = nullptr);
+
+  /**
+   * Admissible move for side, with its ordering score
+   * A move is quiet if it neither makes a threat for side nor occupies a threat square of the opponent
+   */
+  struct CandidateMove {
+    short row, col;
+    int order;
+    bool quiet;
+  };
+  /**
+   * Admissible moves for side on the current board, most promising first
+   */
+  template<class Rules>
+  void generateMoves(char side, std::vector<CandidateMove>* moves);
+  /**
+   * Admissible moves in (row, col) order, unscored
+   */
+  void admissibleCells(std::vector<CandidateMove>* cells);
+  /**
+   * Forcing moves for side: the admissible cells where side makes a threat or takes a threat square
+   * of the opponent
+   */
+  template<class Rules>
+  void generateForcingMoves(char side, std::vector<CandidateMove>* moves);
+  /**
+   * Threats of both sides pending anywhere on the board, by [color], AI_COLOR second
+   * fiveCells receives the empty cells where a side would complete five, three is set if it has an
+   * open three and five if it already has five
+   */
+  template<class Rules>
+  void scanThreats(std::vector<CandidateMove>* fiveCells, bool* three, bool* five);
+  template<class Rules, class Cells>
+  void scanThreats(const Cells& cells, std::vector<CandidateMove>* fiveCells, bool* three, bool* five);
+
+  /**
+   * Minimax settings
+   */
+  short searchDepth;
+  SearchParams searchParams;
+
+  /**
+   * Node count and time limit of the current search
+   */
+  unsigned int totalNodes;
+  int playouts;
+  int treeNodes;
+  bool hasDeadline;
+  bool aborted;
+  std::chrono::steady_clock::time_point deadline;
 
   /**
    * Apply minimax to levels number of moves beneath move
    * Return the score based on whether it's maximize or minimize
    * alphaBetaExtremum = the min or max value from the parent, to be used in alpha-beta
+   * A move with row NULL_MOVE_ROW is a null move (pass) of its side
+   */
+  template<class Rules>
+  int assessMove(GameMove* move, short levels, bool alphaBeta = false, int alphaBetaExtremum = 0);
+
+  /**
+   * Score a leaf where side has just played
+   * While either side has a four or an open three on the board, search the forcing replies until
+   * the position is quiet. Bounds as in assessMove, qDepth = plies below the leaf
    */
-  int assessMove(GameMove* move, short levels, bool alphaBeta = false, short alphaBetaExtremum = 0);
+  template<class Rules>
+  int quiesce(char side, bool alphaBeta, int alphaBetaExtremum, short qDepth);
+  // positions scored by the current quiescence search
+  short quiescenceCount;
 
 };
 
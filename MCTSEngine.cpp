@@ -0,0 +1,525 @@
+#include <cmath>
+#include <string.h>
+#include <system_error>
+#include <thread>
+#include "MCTSEngine.h"
+#include "GameLogic.h"
+#include "Trace.h"
+
+using namespace std;
+
+// exploration constant of the UCT formula
+#define MCTS_EXPLORATION    1.5f
+// losses added to a node while a thread is searching below it
+#define MCTS_VIRTUAL_LOSS   3
+// playouts stopping before a result count as draws
+#define MCTS_PLAYOUT_PLIES  80
+
+// prior weight of a candidate by the number of adjacent own/opponent stones in a direction
+const float POLICY_WEIGHTS[5] = {1.0f, 4.0f, 16.0f, 64.0f, 256.0f};
+
+
+/**
+ * Constructor
+ */
+MCTSEngine::MCTSEngine(short _dim, int _poolSize)
+{
+  dimSize = _dim;
+  SetThreads(0);
+
+  poolSize = _poolSize;
+  pool = new MCTSNode[poolSize];
+  sparePool = new MCTSNode[poolSize];
+  playouts = 0;
+
+  Reset();
+}
+
+
+/**
+ * Destructor
+ */
+MCTSEngine::~MCTSEngine()
+{
+  delete [] pool;
+  delete [] sparePool;
+}
+
+
+/**
+ * _threads = 0 uses every hardware thread
+ */
+void MCTSEngine::SetThreads(short _threads){
+  threads = (_threads > 0) ? _threads : (short)thread::hardware_concurrency();
+  if (threads < 1)
+    threads = 1;
+}
+
+
+int MCTSEngine::GetPlayouts(){
+  return playouts;
+}
+
+
+int MCTSEngine::GetNodesUsed(){
+  int used = poolUsed;
+  return (used < poolSize) ? used : poolSize;
+}
+
+
+/**
+ * Drop the tree
+ */
+void MCTSEngine::Reset(){
+  clearPosition(&root);
+  newRoot(-1, HUMAN_COLOR);
+}
+
+
+/**
+ * Initialize pool[0] as a fresh root for the root position
+ */
+void MCTSEngine::newRoot(short move, char side){
+  MCTSNode* node = &pool[0];
+  node->visits = 0;
+  node->virtualLoss = 0;
+  node->value = 0;
+  node->state = LEAF;
+  node->firstChild = 0;
+  node->numChildren = 0;
+  node->move = move;
+  node->side = side;
+  node->terminal = NOT_TERMINAL;
+  node->prior = 1.0f;
+
+  poolUsed = 1;
+}
+
+
+/**
+ * Search for the best AI move on board for timeLimitMs milliseconds
+ */
+void MCTSEngine::Search(const char* board, int timeLimitMs, short* row, short* col){
+  C5_TRACE_SCOPE("MCTS Search");
+  short numCells = dimSize*dimSize;
+
+  // reuse the tree only if it was advanced to this very position, with the AI to move
+  if (memcmp(board, &root.board[0], numCells) != 0 || pool[0].side != HUMAN_COLOR){
+    clearPosition(&root);
+    for (short ind=0; ind<numCells; ind++){
+      if (board[ind] != UNOCCUPIED)
+        placeStone(&root, ind, board[ind]);
+    }
+    newRoot(-1, HUMAN_COLOR);
+  }
+
+  playouts = 0;
+
+  // the root is expanded up front so that there is a move to return at any deadline
+  MCTSNode* node = &pool[0];
+  if (node->state != EXPANDED){
+    if (!expand(node, &root, AI_COLOR)){
+      newRoot(-1, HUMAN_COLOR);
+      expand(node, &root, AI_COLOR);
+    }
+    node->state = EXPANDED;
+  }
+
+  (*row) = -1;
+  (*col) = -1;
+  if (node->numChildren == 0)
+    return;
+
+  chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(timeLimitMs);
+
+  // search with the helpers that could be started rather than leave the started ones running
+  vector<thread> helpers;
+  try {
+    helpers.reserve(threads);
+    for (short t=1; t<threads; t++)
+      helpers.push_back(thread(&MCTSEngine::worker, this, deadline, 2654435761u*(t+1)));
+  } catch (const system_error&){
+  } catch (const bad_alloc&){
+  }
+  worker(deadline, 2654435761u);
+  for (size_t t=0; t<helpers.size(); t++)
+    helpers[t].join();
+
+  // most visited move
+  int best = node->firstChild;
+  for (short k=1; k<node->numChildren; k++){
+    if (pool[node->firstChild+k].visits > pool[best].visits)
+      best = node->firstChild+k;
+  }
+
+  (*row) = pool[best].move / dimSize;
+  (*col) = pool[best].move % dimSize;
+}
+
+
+/**
+ * Advance the root by a move that was actually played, keeping its subtree
+ */
+void MCTSEngine::Advance(short row, short col, char side){
+  if (row < 0 || row >= dimSize || col < 0 || col >= dimSize)
+    return;
+
+  short ind = row*dimSize+col;
+  if (root.board[ind] != UNOCCUPIED){
+    Reset();
+    return;
+  }
+
+  MCTSNode* node = &pool[0];
+  int child = -1;
+  if (node->state == EXPANDED){
+    for (short k=0; k<node->numChildren; k++){
+      MCTSNode* c = &pool[node->firstChild+k];
+      if (c->move == ind && c->side == side)
+        child = node->firstChild+k;
+    }
+  }
+
+  placeStone(&root, ind, side);
+
+  if (child >= 0)
+    compact(child);
+  else
+    newRoot(ind, side);
+}
+
+
+/**
+ * Copy the subtree under pool[index] into sparePool, breadth first, and swap the pools
+ */
+void MCTSEngine::compact(int index){
+  vector<int> from, to;
+  from.push_back(index);
+  to.push_back(0);
+  int used = 1;
+
+  for (size_t head=0; head<from.size(); head++){
+    MCTSNode* src = &pool[from[head]];
+    MCTSNode* dst = &sparePool[to[head]];
+
+    dst->visits = src->visits.load();
+    dst->virtualLoss = 0;
+    dst->value = src->value.load();
+    dst->move = src->move;
+    dst->side = src->side;
+    dst->terminal = src->terminal;
+    dst->prior = src->prior;
+
+    if (src->state == EXPANDED && src->numChildren > 0 && used+src->numChildren <= poolSize){
+      dst->state = EXPANDED;
+      dst->firstChild = used;
+      dst->numChildren = src->numChildren;
+      for (short k=0; k<src->numChildren; k++){
+        from.push_back(src->firstChild+k);
+        to.push_back(used+k);
+      }
+      used += src->numChildren;
+    } else {
+      // children that do not fit are dropped, the node will be expanded again
+      dst->state = LEAF;
+      dst->firstChild = 0;
+      dst->numChildren = 0;
+    }
+  }
+
+  MCTSNode* swap = pool;
+  pool = sparePool;
+  sparePool = swap;
+  poolUsed = used;
+}
+
+
+/**
+ * Search loop of one thread
+ */
+void MCTSEngine::worker(chrono::steady_clock::time_point deadline, unsigned int seed){
+  C5_TRACE_SCOPE("MCTS worker");
+  short numCells = dimSize*dimSize;
+
+  MCTSWorkspace ws;
+  ws.board.resize(numCells);
+  ws.near.resize(numCells);
+  ws.rng = seed;
+
+  while (chrono::steady_clock::now() < deadline){
+    memcpy(&ws.board[0], &root.board[0], numCells);
+    memcpy(&ws.near[0], &root.near[0], numCells);
+    ws.stones = root.stones;
+    ws.path.clear();
+    ws.path.push_back(0);
+
+    // selection
+    MCTSNode* node = &pool[0];
+    while (node->terminal == NOT_TERMINAL && node->state.load(memory_order_acquire) == EXPANDED && node->numChildren > 0){
+      int c = selectChild(node);
+      node = &pool[c];
+      placeStone(&ws, node->move, node->side);
+      ws.path.push_back(c);
+    }
+
+    // expansion, on the second visit of a leaf
+    if (node->terminal == NOT_TERMINAL && node->visits > 0){
+      int expected = LEAF;
+      if (node->state.compare_exchange_strong(expected, EXPANDING)){
+        char toMove = (node->side == AI_COLOR) ? HUMAN_COLOR : AI_COLOR;
+        if (expand(node, &ws, toMove)){
+          node->state.store(EXPANDED, memory_order_release);
+
+          if (node->numChildren > 0){
+            int c = selectChild(node);
+            node = &pool[c];
+            placeStone(&ws, node->move, node->side);
+            ws.path.push_back(c);
+          }
+        } else {
+          node->state.store(LEAF, memory_order_release);
+        }
+      }
+    }
+
+    // simulation
+    char winner;
+    if (node->terminal == WIN)
+      winner = node->side;
+    else if (node->terminal == DRAW)
+      winner = UNOCCUPIED;
+    else
+      winner = playout(&ws, (node->side == AI_COLOR) ? HUMAN_COLOR : AI_COLOR);
+
+    // backpropagation, the root carries no virtual loss
+    for (size_t k=0; k<ws.path.size(); k++){
+      MCTSNode* n = &pool[ws.path[k]];
+      n->value += (winner == UNOCCUPIED) ? 1 : ((winner == n->side) ? 2 : 0);
+      n->visits++;
+      if (k > 0)
+        n->virtualLoss -= MCTS_VIRTUAL_LOSS;
+    }
+
+    playouts++;
+  }
+}
+
+
+/**
+ * Select the child of node with the best UCT score, with virtual losses applied
+ * Child values are from the point of view of the side to move at node
+ */
+int MCTSEngine::selectChild(MCTSNode* node){
+  float sqrtParent = sqrtf((float)(node->visits + node->virtualLoss + 1));
+
+  int best = node->firstChild;
+  float bestScore = -1.0f;
+  for (short k=0; k<node->numChildren; k++){
+    MCTSNode* c = &pool[node->firstChild+k];
+    int n = c->visits.load(memory_order_relaxed) + c->virtualLoss.load(memory_order_relaxed);
+
+    // unvisited children start at a draw, winning moves at a win
+    float q;
+    if (c->terminal == WIN)
+      q = 1.0f;
+    else if (n == 0)
+      q = 0.5f;
+    else
+      q = c->value.load(memory_order_relaxed) / (2.0f*n);
+
+    float score = q + MCTS_EXPLORATION*c->prior*sqrtParent/(1+n);
+    if (score > bestScore){
+      bestScore = score;
+      best = node->firstChild+k;
+    }
+  }
+
+  pool[best].virtualLoss += MCTS_VIRTUAL_LOSS;
+  return best;
+}
+
+
+/**
+ * Create the children of node for the position in ws, side to move = toMove
+ * Return false if the pool is exhausted
+ */
+bool MCTSEngine::expand(MCTSNode* node, MCTSWorkspace* ws, char toMove){
+  C5_TRACE_SCOPE("expand");
+  short numCells = dimSize*dimSize;
+
+  CandidateKind kind;
+  if (ws->stones == 0){
+    // open in the centre
+    ws->moves.assign(1, (dimSize/2)*dimSize + dimSize/2);
+    ws->weights.assign(1, 1.0f);
+    kind = CANDIDATES;
+  } else {
+    kind = candidates(ws, toMove);
+  }
+
+  short count = (short)ws->moves.size();
+  if (poolUsed.load() + count > poolSize)
+    return false;
+  int first = poolUsed.fetch_add(count);
+  if (first + count > poolSize)
+    return false;
+
+  float total = 0;
+  for (short k=0; k<count; k++)
+    total += ws->weights[k];
+
+  for (short k=0; k<count; k++){
+    MCTSNode* c = &pool[first+k];
+    c->visits = 0;
+    c->virtualLoss = 0;
+    c->value = 0;
+    c->state = LEAF;
+    c->firstChild = 0;
+    c->numChildren = 0;
+    c->move = ws->moves[k];
+    c->side = toMove;
+    c->prior = ws->weights[k]/total;
+
+    if (kind == WINNING_MOVES)
+      c->terminal = WIN;
+    else if (ws->stones+1 == numCells)
+      c->terminal = DRAW;
+    else
+      c->terminal = NOT_TERMINAL;
+  }
+
+  node->firstChild = first;
+  node->numChildren = count;
+  return true;
+}
+
+
+/**
+ * Play from the position in ws with toMove to move until a result or the ply limit
+ * Return the winner, or UNOCCUPIED for a draw
+ */
+char MCTSEngine::playout(MCTSWorkspace* ws, char toMove){
+  C5_TRACE_SCOPE("playout");
+  short numCells = dimSize*dimSize;
+
+  for (short ply=0; ply<MCTS_PLAYOUT_PLIES && ws->stones<numCells; ply++){
+    CandidateKind kind = candidates(ws, toMove);
+    if (ws->moves.empty())
+      return UNOCCUPIED;
+    if (kind == WINNING_MOVES)
+      return toMove;
+
+    // sample a move in proportion to its weight
+    float total = 0;
+    for (size_t k=0; k<ws->weights.size(); k++)
+      total += ws->weights[k];
+
+    ws->rng ^= ws->rng << 13;
+    ws->rng ^= ws->rng >> 17;
+    ws->rng ^= ws->rng << 5;
+    float target = total * (ws->rng / 4294967296.0f);
+
+    size_t pick = 0;
+    for (; pick+1<ws->moves.size(); pick++){
+      target -= ws->weights[pick];
+      if (target < 0)
+        break;
+    }
+
+    placeStone(ws, ws->moves[pick], toMove);
+    toMove = (toMove == AI_COLOR) ? HUMAN_COLOR : AI_COLOR;
+  }
+
+  return UNOCCUPIED;
+}
+
+
+/**
+ * Local evaluation of the candidate moves for toMove
+ * Immediate wins, or else forced blocks, replace the list entirely
+ */
+MCTSEngine::CandidateKind MCTSEngine::candidates(MCTSWorkspace* ws, char toMove){
+  const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+  char other = (toMove == AI_COLOR) ? HUMAN_COLOR : AI_COLOR;
+  short numCells = dimSize*dimSize;
+  const char* board = &ws->board[0];
+
+  ws->moves.clear();
+  ws->weights.clear();
+  CandidateKind kind = CANDIDATES;
+
+  for (short ind=0; ind<numCells; ind++){
+    if (board[ind] != UNOCCUPIED || ws->near[ind] == 0)
+      continue;
+
+    float weight = 0;
+    bool wins = false, blocks = false;
+    for (short d=0; d<4; d++){
+      short own = runThrough(board, ind, DIRECTIONS[d][0], DIRECTIONS[d][1], toMove);
+      short opp = runThrough(board, ind, DIRECTIONS[d][0], DIRECTIONS[d][1], other);
+      wins = wins || own >= 4;
+      blocks = blocks || opp >= 4;
+      weight += POLICY_WEIGHTS[(own<4)?own:4] + POLICY_WEIGHTS[(opp<4)?opp:4];
+    }
+
+    if (wins){
+      if (kind != WINNING_MOVES){
+        ws->moves.clear();
+        ws->weights.clear();
+        kind = WINNING_MOVES;
+      }
+    } else if (kind == WINNING_MOVES){
+      continue;
+    } else if (blocks){
+      if (kind != FORCED_BLOCKS){
+        ws->moves.clear();
+        ws->weights.clear();
+        kind = FORCED_BLOCKS;
+      }
+    } else if (kind == FORCED_BLOCKS){
+      continue;
+    }
+
+    ws->moves.push_back(ind);
+    ws->weights.push_back(weight);
+  }
+
+  return kind;
+}
+
+
+/**
+ * Number of stones of side adjacent to ind in the direction (dirRow, dirCol) and its opposite
+ */
+short MCTSEngine::runThrough(const char* board, short ind, short dirRow, short dirCol, char side){
+  short row = ind / dimSize, col = ind % dimSize;
+  short count = 0;
+
+  for (short i=row+dirRow, j=col+dirCol; i>=0 && i<dimSize && j>=0 && j<dimSize && board[i*dimSize+j]==side; i+=dirRow, j+=dirCol)
+    count++;
+  for (short i=row-dirRow, j=col-dirCol; i>=0 && i<dimSize && j>=0 && j<dimSize && board[i*dimSize+j]==side; i-=dirRow, j-=dirCol)
+    count++;
+
+  return count;
+}
+
+
+void MCTSEngine::placeStone(MCTSWorkspace* ws, short ind, char side){
+  short row = ind / dimSize, col = ind % dimSize;
+
+  ws->board[ind] = side;
+  ws->stones++;
+
+  for (short i=row-1; i<=row+1; i++)
+    if (i>=0 && i<dimSize)
+      for (short j=col-1; j<=col+1; j++)
+        if (j>=0 && j<dimSize)
+          ws->near[i*dimSize+j]++;
+}
+
+
+void MCTSEngine::clearPosition(MCTSWorkspace* ws){
+  ws->board.assign(dimSize*dimSize, UNOCCUPIED);
+  ws->near.assign(dimSize*dimSize, 0);
+  ws->stones = 0;
+}
@@ -0,0 +1,172 @@
+#ifndef MCTS_ENGINE_H
+#define MCTS_ENGINE_H
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+/**
+ * Node of the Monte Carlo search tree
+ * Children of a node are stored contiguously in the node pool
+ */
+struct MCTSNode {
+  // playouts through this node, including virtual losses of searches in progress
+  std::atomic<int> visits;
+  std::atomic<int> virtualLoss;
+  // sum of playout results for side, 2 = win, 1 = draw, 0 = loss
+  std::atomic<int> value;
+  // LEAF, EXPANDING or EXPANDED
+  std::atomic<int> state;
+
+  int firstChild;
+  short numChildren;
+
+  // the move leading to this node, ind = row*dimSize+col, -1 for an empty root
+  short move;
+  char side;
+  // NOT_TERMINAL, WIN (side has five) or DRAW (board full)
+  char terminal;
+
+  // policy prior from the local evaluator
+  float prior;
+};
+
+
+/**
+ * Per-thread scratch state: the position reached by the current descent and its candidates
+ */
+struct MCTSWorkspace {
+  std::vector<char> board;
+  // number of stones in the 3x3 neighbourhood of each cell
+  std::vector<char> near;
+  short stones;
+
+  std::vector<int> path;
+  std::vector<short> moves;
+  std::vector<float> weights;
+  unsigned int rng;
+};
+
+
+/**
+ * Monte Carlo tree search (UCT with policy priors) for the AI player
+ *
+ * Several threads descend the same tree, steering each other away from the paths in progress with
+ * virtual losses. Nodes come from a preallocated pool. Between turns the subtree under the moves
+ * actually played is kept (see Advance), so the search resumes with the statistics of the previous turn.
+ * The search is anytime: it stops at the deadline and returns the most visited move.
+ */
+class MCTSEngine
+{
+public:
+  MCTSEngine(short _dim, int _poolSize = 1<<19);
+  ~MCTSEngine();
+
+  /**
+   * _threads = 0 uses every hardware thread
+   */
+  void SetThreads(short _threads);
+
+  /**
+   * Search for the best AI move on board (dimSize*dimSize cells) for timeLimitMs milliseconds
+   * The tree is reused if board is the position reached through Advance, otherwise it is rebuilt
+   */
+  void Search(const char* board, int timeLimitMs, short* row, short* col);
+
+  /**
+   * Advance the root by a move that was actually played, keeping its subtree
+   */
+  void Advance(short row, short col, char side);
+
+  /**
+   * Drop the tree
+   */
+  void Reset();
+
+  /**
+   * Statistics of the last search
+   */
+  int GetPlayouts();
+  int GetNodesUsed();
+
+  enum NodeState {
+    LEAF,
+    EXPANDING,
+    EXPANDED
+  };
+  enum Terminal {
+    NOT_TERMINAL,
+    WIN,
+    DRAW
+  };
+
+private:
+  short dimSize;
+  short threads;
+
+  // two pools of poolSize nodes, the subtree kept by Advance is compacted from one into the other
+  int poolSize;
+  MCTSNode* pool;
+  MCTSNode* sparePool;
+  std::atomic<int> poolUsed;
+
+  // position at the root, in the same form as the workspaces
+  MCTSWorkspace root;
+
+  std::atomic<int> playouts;
+
+  /**
+   * Initialize pool[0] as a fresh root for the root position
+   */
+  void newRoot(short move, char side);
+
+  /**
+   * Copy the subtree under pool[index] into sparePool and swap the pools
+   */
+  void compact(int index);
+
+  /**
+   * Search loop of one thread
+   */
+  void worker(std::chrono::steady_clock::time_point deadline, unsigned int seed);
+
+  /**
+   * Select the child of node with the best UCT score, with virtual losses applied
+   */
+  int selectChild(MCTSNode* node);
+
+  /**
+   * Create the children of node for the position in ws, side to move = toMove
+   * Return false if the pool is exhausted
+   */
+  bool expand(MCTSNode* node, MCTSWorkspace* ws, char toMove);
+
+  /**
+   * Play from the position in ws with toMove to move until a result or the ply limit
+   * Return the winner, or UNOCCUPIED for a draw
+   */
+  char playout(MCTSWorkspace* ws, char toMove);
+
+  /**
+   * Local evaluation of the candidate moves: fills ws->moves and ws->weights with the empty cells
+   * next to a stone and their prior weights for toMove.
+   * Immediate wins, or else forced blocks, replace the list entirely
+   * Return WINNING_MOVES, FORCED_BLOCKS or the regular CANDIDATES
+   */
+  enum CandidateKind {
+    CANDIDATES,
+    WINNING_MOVES,
+    FORCED_BLOCKS
+  };
+  CandidateKind candidates(MCTSWorkspace* ws, char toMove);
+
+  /**
+   * Number of stones of side adjacent to ind in the direction (dirRow, dirCol) and its opposite
+   */
+  short runThrough(const char* board, short ind, short dirRow, short dirCol, char side);
+
+  void placeStone(MCTSWorkspace* ws, short ind, char side);
+  void clearPosition(MCTSWorkspace* ws);
+};
+
+#endif
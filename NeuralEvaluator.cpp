@@ -0,0 +1,227 @@
+#include <cstdlib>
+#include <fstream>
+#include <string.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "NeuralEvaluator.h"
+#include "GameLogic.h"
+
+using namespace std;
+
+#define NEURAL_MAGIC    "C5NN"
+#define NEURAL_VERSION  1
+
+
+/**
+ * Constructor
+ */
+NeuralEvaluator::NeuralEvaluator()
+{
+  dimSize = 0;
+  hiddenSize = 0;
+  featureWeights = nullptr;
+  featureBias = nullptr;
+  outputWeights = nullptr;
+  outputBias = 0;
+  accumulator = nullptr;
+}
+
+
+/**
+ * Destructor
+ */
+NeuralEvaluator::~NeuralEvaluator()
+{
+  Unload();
+}
+
+
+/**
+ * Load the weight file at path for a board of dimension dim
+ * Layout (little endian):
+ *   char[4] magic, uint32 version, uint32 dimSize, uint32 hiddenSize,
+ *   int16 featureBias[hiddenSize], int16 featureWeights[2*dimSize*dimSize][hiddenSize],
+ *   int8 outputWeights[hiddenSize], int32 outputBias
+ */
+bool NeuralEvaluator::Load(const char* path, short dim){
+  Unload();
+
+  ifstream in(path, ios::binary);
+  if (!in)
+    return false;
+
+  char magic[4];
+  uint32_t header[3];
+  in.read(magic, 4);
+  in.read((char*)header, sizeof(header));
+  if (!in || memcmp(magic, NEURAL_MAGIC, 4) != 0 || header[0] != NEURAL_VERSION)
+    return false;
+
+  // the hidden layer is processed 16 lanes at a time
+  if (header[1] != (uint32_t)dim || header[2] == 0 || header[2] % 16 != 0 || header[2] > 1024)
+    return false;
+
+  dimSize = dim;
+  hiddenSize = (short)header[2];
+  int numFeatures = 2*dimSize*dimSize;
+
+  featureBias = new int16_t[hiddenSize];
+  featureWeights = new int16_t[numFeatures*hiddenSize];
+  outputWeights = new int16_t[hiddenSize];
+  accumulator = new int16_t[hiddenSize];
+
+  in.read((char*)featureBias, hiddenSize*sizeof(int16_t));
+  in.read((char*)featureWeights, numFeatures*hiddenSize*sizeof(int16_t));
+
+  int8_t* narrow = new int8_t[hiddenSize];
+  in.read((char*)narrow, hiddenSize);
+  for (short h=0; h<hiddenSize; h++)
+    outputWeights[h] = narrow[h];
+  delete [] narrow;
+
+  in.read((char*)&outputBias, sizeof(outputBias));
+
+  if (!in || !isBounded()){
+    Unload();
+    return false;
+  }
+
+  Reset();
+  return true;
+}
+
+
+void NeuralEvaluator::Unload(){
+  delete [] featureWeights;
+  delete [] featureBias;
+  delete [] outputWeights;
+  delete [] accumulator;
+
+  featureWeights = nullptr;
+  featureBias = nullptr;
+  outputWeights = nullptr;
+  accumulator = nullptr;
+  outputBias = 0;
+  dimSize = 0;
+  hiddenSize = 0;
+}
+
+
+bool NeuralEvaluator::IsLoaded(){
+  return accumulator != nullptr;
+}
+
+
+short NeuralEvaluator::GetDimSize(){
+  return dimSize;
+}
+
+
+/**
+ * Reset the accumulator to an empty board
+ */
+void NeuralEvaluator::Reset(){
+  memcpy(accumulator, featureBias, hiddenSize*sizeof(int16_t));
+}
+
+
+/**
+ * Whether no board can take an accumulator lane outside the int16 range: the bias plus, per cell,
+ * the larger of its two color weights, since a cell holds one stone at most
+ */
+bool NeuralEvaluator::isBounded(){
+  int numCells = dimSize*dimSize;
+
+  for (short h=0; h<hiddenSize; h++){
+    int32_t reach = abs(featureBias[h]);
+    for (int ind=0; ind<numCells; ind++){
+      int32_t ai = abs(featureWeights[ind*hiddenSize + h]);
+      int32_t human = abs(featureWeights[(numCells + ind)*hiddenSize + h]);
+      reach += (ai > human) ? ai : human;
+    }
+    if (reach > INT16_MAX)
+      return false;
+  }
+  return true;
+}
+
+
+/**
+ * Weight row of the feature for side at ind
+ */
+const int16_t* NeuralEvaluator::featureRow(short ind, char side){
+  int feature = (side == AI_COLOR) ? ind : dimSize*dimSize + ind;
+  return featureWeights + feature*hiddenSize;
+}
+
+
+void NeuralEvaluator::AddStone(short ind, char side){
+  const int16_t* row = featureRow(ind, side);
+
+#if defined(__AVX2__)
+  for (short h=0; h<hiddenSize; h+=16){
+    __m256i acc = _mm256_loadu_si256((const __m256i*)(accumulator+h));
+    __m256i w = _mm256_loadu_si256((const __m256i*)(row+h));
+    _mm256_storeu_si256((__m256i*)(accumulator+h), _mm256_add_epi16(acc, w));
+  }
+#else
+  for (short h=0; h<hiddenSize; h++)
+    accumulator[h] += row[h];
+#endif
+}
+
+
+void NeuralEvaluator::RemoveStone(short ind, char side){
+  const int16_t* row = featureRow(ind, side);
+
+#if defined(__AVX2__)
+  for (short h=0; h<hiddenSize; h+=16){
+    __m256i acc = _mm256_loadu_si256((const __m256i*)(accumulator+h));
+    __m256i w = _mm256_loadu_si256((const __m256i*)(row+h));
+    _mm256_storeu_si256((__m256i*)(accumulator+h), _mm256_sub_epi16(acc, w));
+  }
+#else
+  for (short h=0; h<hiddenSize; h++)
+    accumulator[h] -= row[h];
+#endif
+}
+
+
+/**
+ * Run the output layer on the current accumulator
+ * Return a score from the AI's perspective
+ */
+int NeuralEvaluator::Evaluate(){
+  int32_t sum = 0;
+
+#if defined(__AVX2__)
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ceiling = _mm256_set1_epi16(ACTIVATION_SCALE);
+  __m256i total = _mm256_setzero_si256();
+
+  for (short h=0; h<hiddenSize; h+=16){
+    __m256i acc = _mm256_loadu_si256((const __m256i*)(accumulator+h));
+    __m256i w = _mm256_loadu_si256((const __m256i*)(outputWeights+h));
+
+    // clipped ReLU, then pairwise multiply-add into 8 int32 lanes
+    acc = _mm256_max_epi16(_mm256_min_epi16(acc, ceiling), zero);
+    total = _mm256_add_epi32(total, _mm256_madd_epi16(acc, w));
+  }
+
+  // horizontal sum of the 8 lanes
+  __m128i half = _mm_add_epi32(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+  half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+  half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+  sum = _mm_cvtsi128_si32(half);
+#else
+  for (short h=0; h<hiddenSize; h++){
+    int32_t a = accumulator[h];
+    a = (a<0) ? 0 : ((a>ACTIVATION_SCALE) ? ACTIVATION_SCALE : a);
+    sum += a*outputWeights[h];
+  }
+#endif
+
+  // the network predicts a win logit, scale it into assessBoard units
+  return (int)(((int64_t)sum + outputBias) * OUTPUT_SCALE / (ACTIVATION_SCALE*WEIGHT_SCALE));
+}
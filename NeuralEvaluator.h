@@ -0,0 +1,71 @@
+#ifndef NEURAL_EVALUATOR_H
+#define NEURAL_EVALUATOR_H
+
+#include <stdint.h>
+
+/**
+ * Small quantized neural network used as an alternative to the handcrafted assessBoard
+ *
+ * Topology: one input feature per (cell, color), a hidden layer of hiddenSize clipped ReLU units
+ * and a single win logit for the AI, scaled by OUTPUT_SCALE into the same units as assessBoard.
+ * The hidden layer pre-activations (the accumulator) are updated incrementally as stones are
+ * placed and removed, so Evaluate only pays for the output layer.
+ *
+ * Weights are produced by tools/train_nnue.py, see that script for the file layout
+ */
+class NeuralEvaluator
+{
+public:
+  NeuralEvaluator();
+  ~NeuralEvaluator();
+
+  /**
+   * Load the weight file at path for a board of dimension dim
+   * Return false if the file is missing, malformed or trained for another board size, or if its
+   * weights could overflow the int16 accumulator on some board
+   */
+  bool Load(const char* path, short dim);
+  void Unload();
+  bool IsLoaded();
+  short GetDimSize();
+
+  /**
+   * Reset the accumulator to an empty board
+   */
+  void Reset();
+
+  /**
+   * Incrementally update the accumulator, ind = row*dimSize+col
+   */
+  void AddStone(short ind, char side);
+  void RemoveStone(short ind, char side);
+
+  /**
+   * Run the output layer on the current accumulator
+   */
+  int Evaluate();
+
+  // quantization: hidden activations are scaled by ACTIVATION_SCALE, output weights by WEIGHT_SCALE
+  static const int ACTIVATION_SCALE = 127;
+  static const int WEIGHT_SCALE = 64;
+  // score units per unit of win logit
+  static const int OUTPUT_SCALE = 400;
+
+private:
+  short dimSize;
+  short hiddenSize;
+
+  // [2*dimSize*dimSize][hiddenSize], AI_COLOR features first
+  int16_t* featureWeights;
+  int16_t* featureBias;
+  // stored widened to int16 for the multiply-add
+  int16_t* outputWeights;
+  int32_t outputBias;
+
+  int16_t* accumulator;
+
+  const int16_t* featureRow(short ind, char side);
+  bool isBounded();
+};
+
+#endif
@@ -0,0 +1,468 @@
+#include <algorithm>
+#include <climits>
+#include <string.h>
+#include "ProofSolver.h"
+#include "GameLogic.h"
+
+using namespace std;
+
+// proof and disproof numbers saturate here, a node is solved when one of them reaches 0
+#define PROOF_INFINITY  (1u << 30)
+#define TABLE_WAYS      4
+// Zobrist keys are derived from this seed, changing it invalidates every SolvedTable file
+#define ZOBRIST_SEED    0x2545F4914F6CDD1DULL
+
+
+namespace {
+
+/**
+ * splitmix64 finalizer
+ */
+uint64_t mix(uint64_t z){
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+const uint64_t SIDE_KEY = mix(ZOBRIST_SEED ^ 0x5349444531ULL);
+const uint64_t ATTACKER_KEY = mix(ZOBRIST_SEED ^ 0x41545441ULL);
+const uint64_t THREATS_KEY = mix(ZOBRIST_SEED ^ 0x54485245ULL);
+
+uint32_t saturate(uint64_t n){
+  return (n > PROOF_INFINITY) ? PROOF_INFINITY : (uint32_t)n;
+}
+
+}
+
+
+/**
+ * Constructor
+ */
+ProofSolver::ProofSolver(short _dim, short tableBits)
+{
+  dimSize = _dim;
+  rules = FREESTYLE_RULES;
+
+  int numCells = dimSize*dimSize;
+  board = new char[numCells];
+  lineStones[0] = new uint8_t[numCells];
+  lineStones[1] = new uint8_t[numCells];
+  key = 0;
+
+  uint32_t size = 1u << max((short)2, tableBits);
+  table = new TableEntry[size];
+  tableMask = size-1;
+  ClearTable();
+
+  attacker = AI_COLOR;
+  threatsOnly = false;
+  nodes = 0;
+  maxNodes = 0;
+}
+
+
+/**
+ * Destructor
+ */
+ProofSolver::~ProofSolver()
+{
+  delete [] board;
+  delete [] lineStones[0];
+  delete [] lineStones[1];
+  delete [] table;
+}
+
+
+void ProofSolver::SetRules(RuleVariant _rules){
+  // stored proofs only hold under the rules they were made with
+  if (_rules != rules)
+    ClearTable();
+  rules = _rules;
+}
+
+
+void ProofSolver::ClearTable(){
+  memset(table, 0, (tableMask+1)*sizeof(TableEntry));
+}
+
+
+unsigned int ProofSolver::GetNodeCount(){
+  return nodes;
+}
+
+
+ProofOutcome ProofSolver::Solve(const char* _board, char side, unsigned int _maxNodes){
+  return solve(_board, side, _maxNodes, false);
+}
+
+
+ProofOutcome ProofSolver::SolveThreats(const char* _board, char side, unsigned int _maxNodes){
+  return solve(_board, side, _maxNodes, true);
+}
+
+
+ProofOutcome ProofSolver::solve(const char* _board, char side, unsigned int _maxNodes, bool _threatsOnly){
+  ProofOutcome outcome;
+  outcome.result = PROOF_UNKNOWN;
+  outcome.distance = 0;
+  outcome.row = outcome.col = -1;
+
+  nodes = 0;
+  maxNodes = _maxNodes;
+  threatsOnly = _threatsOnly;
+  if (rules == RENJU_RULES)
+    return outcome;
+
+  int numCells = dimSize*dimSize;
+  memset(board, UNOCCUPIED, numCells);
+  memset(lineStones[0], 0, numCells);
+  memset(lineStones[1], 0, numCells);
+  key = 0;
+  for (short ind=0; ind<numCells; ind++){
+    if (_board[ind] != UNOCCUPIED)
+      place(ind, _board[ind]);
+  }
+
+  // first whether side wins, then whether it loses. Neither means a draw, unless out of budget
+  char other = (side == AI_COLOR) ? HUMAN_COLOR : AI_COLOR;
+  uint32_t pn, dn;
+  short distance, move;
+
+  attacker = side;
+  if (rules == EXACT_FIVE_RULES)
+    prove<ExactFiveRules>(side, &pn, &dn);
+  else
+    prove<FreestyleRules>(side, &pn, &dn);
+  TableEntry* e = lookup(searchKey(key ^ (side == AI_COLOR ? SIDE_KEY : 0)));
+  if (pn == 0 && e != nullptr){
+    outcome.result = PROOF_WIN;
+    outcome.distance = e->distance;
+    outcome.row = e->move / dimSize;
+    outcome.col = e->move % dimSize;
+    return outcome;
+  }
+  if (threatsOnly || dn != 0)
+    return outcome;
+
+  attacker = other;
+  if (rules == EXACT_FIVE_RULES)
+    prove<ExactFiveRules>(side, &pn, &dn);
+  else
+    prove<FreestyleRules>(side, &pn, &dn);
+  e = lookup(searchKey(key ^ (side == AI_COLOR ? SIDE_KEY : 0)));
+  if ((pn != 0 && dn != 0) || e == nullptr)
+    return outcome;
+
+  distance = e->distance;
+  move = e->move;
+  outcome.result = (pn == 0) ? PROOF_LOSS : PROOF_DRAW;
+  outcome.distance = (pn == 0) ? distance : 0;
+  if (move >= 0){
+    outcome.row = move / dimSize;
+    outcome.col = move % dimSize;
+  }
+  return outcome;
+}
+
+
+/**
+ * Search the current board with side to move until attacker's win is proven or disproven,
+ * or the budget runs out, and return the proof and disproof numbers of the root
+ */
+template<class Rules>
+void ProofSolver::prove(char side, uint32_t* pn, uint32_t* dn){
+  mid<Rules>(side, PROOF_INFINITY, PROOF_INFINITY);
+
+  TableEntry* e = lookup(searchKey(key ^ (side == AI_COLOR ? SIDE_KEY : 0)));
+  (*pn) = (e != nullptr) ? e->pn : 1;
+  (*dn) = (e != nullptr) ? e->dn : 1;
+}
+
+
+/**
+ * Multiple iterative deepening: expand the most proving child of the current board, with side to
+ * move, until its proof number reaches thpn or its disproof number reaches thdn
+ * The attacker's nodes are OR nodes (one proven child proves them), the defender's AND nodes
+ */
+template<class Rules>
+void ProofSolver::mid(char side, uint32_t thpn, uint32_t thdn){
+  nodes++;
+  unsigned int startNodes = nodes;
+
+  char other = (side == AI_COLOR) ? HUMAN_COLOR : AI_COLOR;
+  bool isOr = (side == attacker);
+  uint64_t nodeKey = searchKey(key ^ (side == AI_COLOR ? SIDE_KEY : 0));
+
+  vector<short> moves;
+  if (generate<Rules>(side, &moves)){
+    // side makes five at once
+    if (isOr)
+      store(nodeKey, 0, PROOF_INFINITY, 1, 1, moves[0]);
+    else
+      store(nodeKey, PROOF_INFINITY, 0, 1, 0, moves[0]);
+    return;
+  }
+  if (moves.empty()){
+    // a full board, or no four left to play: the attacker does not win
+    store(nodeKey, PROOF_INFINITY, 0, 1, 0, -1);
+    return;
+  }
+
+  size_t numMoves = moves.size();
+  vector<uint64_t> childKeys(numMoves);
+  uint64_t childSide = (other == AI_COLOR ? SIDE_KEY : 0);
+  for (size_t k=0; k<numMoves; k++)
+    childKeys[k] = searchKey(key ^ cellKey(moves[k], side) ^ childSide);
+
+  while (1){
+    // OR: pn = min of the children, dn = sum. AND: the other way round
+    uint64_t sum = 0;
+    uint32_t best = PROOF_INFINITY, second = PROOF_INFINITY;
+    size_t bestChild = 0;
+    uint32_t bestPn = 1, bestDn = 1;
+    short solvedDistance = isOr ? SHRT_MAX : 0, solvedMove = -1, refutingMove = -1;
+
+    for (size_t k=0; k<numMoves; k++){
+      TableEntry* e = lookup(childKeys[k]);
+      uint32_t cpn = (e != nullptr) ? e->pn : 1;
+      uint32_t cdn = (e != nullptr) ? e->dn : 1;
+      uint32_t value = isOr ? cpn : cdn;
+
+      sum += isOr ? cdn : cpn;
+      if (value < best){
+        second = best;
+        best = value;
+        bestChild = k;
+        bestPn = cpn;
+        bestDn = cdn;
+      } else if (value < second)
+        second = value;
+
+      // the shortest win among proven children, or the longest defence when all are proven
+      if (cpn == 0){
+        if (isOr ? e->distance < solvedDistance : e->distance > solvedDistance){
+          solvedDistance = e->distance;
+          solvedMove = moves[k];
+        }
+      } else if (cdn == 0 && refutingMove < 0)
+        refutingMove = moves[k];
+    }
+
+    uint32_t pn = isOr ? best : saturate(sum);
+    uint32_t dn = isOr ? saturate(sum) : best;
+    if (pn >= thpn || dn >= thdn || nodes >= maxNodes){
+      short distance = (pn == 0) ? solvedDistance+1 : 0;
+      short move = (pn == 0) ? solvedMove : ((dn == 0 && !isOr) ? refutingMove : -1);
+      store(nodeKey, pn, dn, nodes-startNodes+1, distance, move);
+      return;
+    }
+
+    // thresholds of the best child, so that it returns as soon as another child becomes better
+    uint32_t childPn, childDn;
+    if (isOr){
+      childPn = min(thpn, second+1);
+      childDn = saturate((uint64_t)thdn - dn + bestDn);
+    } else {
+      childPn = saturate((uint64_t)thpn - pn + bestPn);
+      childDn = min(thdn, second+1);
+    }
+
+    place(moves[bestChild], side);
+    mid<Rules>(other, childPn, childDn);
+    remove(moves[bestChild], side);
+  }
+}
+
+
+/**
+ * Moves of side on the current board
+ * Return true, with the winning cell in moves, if side makes five at once. Otherwise a side
+ * facing a five in one move may only block it; the attacker of SolveThreats may only play fours,
+ * and every empty cell is tried in the other cases, those nearest the stones first
+ */
+template<class Rules>
+bool ProofSolver::generate(char side, vector<short>* moves){
+  char other = (side == AI_COLOR) ? HUMAN_COLOR : AI_COLOR;
+  short numCells = dimSize*dimSize;
+  moves->clear();
+
+  for (short ind=0; ind<numCells; ind++){
+    if (board[ind] == UNOCCUPIED && completesFive<Rules>(ind, side)){
+      moves->push_back(ind);
+      return true;
+    }
+  }
+
+  for (short ind=0; ind<numCells; ind++){
+    if (board[ind] == UNOCCUPIED && completesFive<Rules>(ind, other))
+      moves->push_back(ind);
+  }
+  if (!moves->empty())
+    return false;
+
+  if (threatsOnly && side == attacker){
+    for (short ind=0; ind<numCells; ind++){
+      if (board[ind] == UNOCCUPIED && makesFour<Rules>(ind, side))
+        moves->push_back(ind);
+    }
+    return false;
+  }
+
+  for (short ind=0; ind<numCells; ind++){
+    if (board[ind] == UNOCCUPIED)
+      moves->push_back(ind);
+  }
+  uint8_t* near0 = lineStones[0];
+  uint8_t* near1 = lineStones[1];
+  stable_sort(moves->begin(), moves->end(), [near0, near1](short a, short b){
+    return near0[a] + near1[a] > near0[b] + near1[b];
+  });
+  return false;
+}
+
+
+/**
+ * Whether side playing the empty cell ind wins
+ */
+template<class Rules>
+bool ProofSolver::completesFive(short ind, char side){
+  if (lineStones[side == AI_COLOR][ind] < 4)
+    return false;
+
+  const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+  short row = ind / dimSize, col = ind % dimSize;
+  for (short d=0; d<4; d++){
+    short length = 1;
+    for (short s=-1; s<=1; s+=2){
+      short r = row + s*DIRECTIONS[d][0], c = col + s*DIRECTIONS[d][1];
+      while (r >= 0 && r < dimSize && c >= 0 && c < dimSize && board[r*dimSize+c] == side){
+        length++;
+        r += s*DIRECTIONS[d][0];
+        c += s*DIRECTIONS[d][1];
+      }
+    }
+    if (Rules::IsWin(length, side == HUMAN_COLOR))
+      return true;
+  }
+  return false;
+}
+
+
+/**
+ * Whether side playing the empty cell ind threatens to make five on its next move
+ */
+template<class Rules>
+bool ProofSolver::makesFour(short ind, char side){
+  if (lineStones[side == AI_COLOR][ind] < 3)
+    return false;
+
+  const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+  short row = ind / dimSize, col = ind % dimSize;
+  bool four = false;
+
+  place(ind, side);
+  for (short d=0; d<4 && !four; d++){
+    for (short step=-4; step<=4 && !four; step++){
+      short r = row + step*DIRECTIONS[d][0], c = col + step*DIRECTIONS[d][1];
+      if (step != 0 && r >= 0 && r < dimSize && c >= 0 && c < dimSize && board[r*dimSize+c] == UNOCCUPIED)
+        four = completesFive<Rules>(r*dimSize+c, side);
+    }
+  }
+  remove(ind, side);
+
+  return four;
+}
+
+
+/**
+ * Place a stone, updating the key and the stone counts of the cells on its lines
+ */
+void ProofSolver::place(short ind, char side){
+  const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+  uint8_t* counts = lineStones[side == AI_COLOR];
+  short row = ind / dimSize, col = ind % dimSize;
+
+  board[ind] = side;
+  key ^= cellKey(ind, side);
+  for (short d=0; d<4; d++){
+    for (short step=-4; step<=4; step++){
+      short r = row + step*DIRECTIONS[d][0], c = col + step*DIRECTIONS[d][1];
+      if (step != 0 && r >= 0 && r < dimSize && c >= 0 && c < dimSize)
+        counts[r*dimSize+c]++;
+    }
+  }
+}
+
+
+void ProofSolver::remove(short ind, char side){
+  const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+  uint8_t* counts = lineStones[side == AI_COLOR];
+  short row = ind / dimSize, col = ind % dimSize;
+
+  board[ind] = UNOCCUPIED;
+  key ^= cellKey(ind, side);
+  for (short d=0; d<4; d++){
+    for (short step=-4; step<=4; step++){
+      short r = row + step*DIRECTIONS[d][0], c = col + step*DIRECTIONS[d][1];
+      if (step != 0 && r >= 0 && r < dimSize && c >= 0 && c < dimSize)
+        counts[r*dimSize+c]--;
+    }
+  }
+}
+
+
+ProofSolver::TableEntry* ProofSolver::lookup(uint64_t _key){
+  TableEntry* bucket = table + (_key & tableMask & ~(uint64_t)(TABLE_WAYS-1));
+  for (int w=0; w<TABLE_WAYS; w++){
+    if (bucket[w].key == _key && bucket[w].work > 0)
+      return &bucket[w];
+  }
+  return nullptr;
+}
+
+
+/**
+ * Store a node over its previous entry, or else over the entry of its bucket with the least work
+ */
+void ProofSolver::store(uint64_t _key, uint32_t pn, uint32_t dn, uint32_t work, short distance, short move){
+  TableEntry* bucket = table + (_key & tableMask & ~(uint64_t)(TABLE_WAYS-1));
+  TableEntry* e = &bucket[0];
+  for (int w=0; w<TABLE_WAYS; w++){
+    if (bucket[w].key == _key){
+      e = &bucket[w];
+      break;
+    }
+    if (bucket[w].work < e->work)
+      e = &bucket[w];
+  }
+
+  e->key = _key;
+  e->pn = pn;
+  e->dn = dn;
+  e->work = work;
+  e->distance = distance;
+  e->move = move;
+}
+
+
+/**
+ * The table holds both searches of Solve and those of SolveThreats, they are told apart by key
+ */
+uint64_t ProofSolver::searchKey(uint64_t positionKey){
+  return positionKey ^ (attacker == AI_COLOR ? ATTACKER_KEY : 0) ^ (threatsOnly ? THREATS_KEY : 0);
+}
+
+
+uint64_t ProofSolver::cellKey(int ind, char side){
+  return mix(ZOBRIST_SEED + 0x9E3779B97F4A7C15ULL*(uint64_t)(2*ind + (side == AI_COLOR) + 1));
+}
+
+
+uint64_t ProofSolver::PositionKey(const char* board, short dim, char side){
+  uint64_t positionKey = (side == AI_COLOR) ? SIDE_KEY : 0;
+  for (int ind=0; ind<dim*dim; ind++){
+    if (board[ind] != UNOCCUPIED)
+      positionKey ^= cellKey(ind, board[ind]);
+  }
+  return positionKey;
+}
@@ -0,0 +1,131 @@
+#ifndef PROOF_SOLVER_H
+#define PROOF_SOLVER_H
+
+#include <stdint.h>
+#include <vector>
+#include "RuleVariants.h"
+
+/**
+ * Game-theoretic value of a position for the side to move
+ */
+enum ProofResult {
+  PROOF_UNKNOWN,
+  PROOF_WIN,
+  PROOF_LOSS,
+  PROOF_DRAW
+};
+
+/**
+ * Solved position: its value, the plies until the five of the winner along the proof found
+ * (1 = the side to move wins at once), and the move to play, row < 0 if there is none
+ */
+struct ProofOutcome {
+  ProofResult result;
+  short distance;
+  short row, col;
+};
+
+
+/**
+ * Depth-first proof-number search (df-pn) on a dense board
+ *
+ * Proves or disproves that a side wins, under freestyle or exact-five rules. Proof and disproof
+ * numbers are kept in a transposition table of a fixed number of entries, the least searched
+ * entry of a bucket making room for a new one, so memory stays bounded however long it runs.
+ * Positions are hashed with Zobrist keys drawn from a fixed seed, which makes the keys of a
+ * position the same in every process: they index the solved positions of SolvedTable.
+ *
+ * A side facing a five in one move may only block it, which is exact and keeps most threat
+ * sequences narrow. Solve otherwise tries every empty cell and is meant for small boards,
+ * SolveThreats only lets the attacker play fours and finds forced wins on any board.
+ */
+class ProofSolver
+{
+public:
+  /**
+   * A transposition table of 2^tableBits entries
+   */
+  ProofSolver(short _dim, short tableBits);
+  ~ProofSolver();
+
+  /**
+   * Renju is not supported: its forbidden moves are not generated, Solve returns PROOF_UNKNOWN
+   */
+  void SetRules(RuleVariant _rules);
+
+  /**
+   * Value of board (dimSize*dimSize cells, UNOCCUPIED or a color) for side to move
+   * PROOF_UNKNOWN if not solved within maxNodes positions
+   */
+  ProofOutcome Solve(const char* board, char side, unsigned int maxNodes);
+
+  /**
+   * Whether side to move wins by a sequence of fours, each forcing the opponent's reply
+   * PROOF_WIN or PROOF_UNKNOWN
+   */
+  ProofOutcome SolveThreats(const char* board, char side, unsigned int maxNodes);
+
+  /**
+   * Positions searched by the last Solve or SolveThreats
+   */
+  unsigned int GetNodeCount();
+
+  /**
+   * Forget every stored proof
+   */
+  void ClearTable();
+
+  /**
+   * Zobrist key of board with side to move
+   */
+  static uint64_t PositionKey(const char* board, short dim, char side);
+
+private:
+  short dimSize;
+  RuleVariant rules;
+
+  /**
+   * Board being searched, its Zobrist key, and per cell and side the number of stones of that side
+   * at most 4 cells away on the cell's lines: a cell completes a five only if it sees 4 of them
+   */
+  char* board;
+  uint64_t key;
+  uint8_t* lineStones[2];
+  void place(short ind, char side);
+  void remove(short ind, char side);
+
+  /**
+   * Transposition table, in buckets of TABLE_WAYS entries
+   */
+  struct TableEntry {
+    uint64_t key;
+    uint32_t pn, dn;
+    uint32_t work;
+    short distance;
+    short move;
+  };
+  TableEntry* table;
+  uint32_t tableMask;
+  TableEntry* lookup(uint64_t _key);
+  void store(uint64_t _key, uint32_t pn, uint32_t dn, uint32_t work, short distance, short move);
+
+  /**
+   * The search in progress: who tries to win, whether only its fours are tried, and the budget
+   */
+  char attacker;
+  bool threatsOnly;
+  unsigned int nodes;
+  unsigned int maxNodes;
+  uint64_t searchKey(uint64_t positionKey);
+
+  ProofOutcome solve(const char* _board, char side, unsigned int _maxNodes, bool _threatsOnly);
+  template<class Rules> void prove(char side, uint32_t* pn, uint32_t* dn);
+  template<class Rules> void mid(char side, uint32_t thpn, uint32_t thdn);
+  template<class Rules> bool completesFive(short ind, char side);
+  template<class Rules> bool makesFour(short ind, char side);
+  template<class Rules> bool generate(char side, std::vector<short>* moves);
+
+  static uint64_t cellKey(int ind, char side);
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef RULE_VARIANTS_H
+#define RULE_VARIANTS_H
+
+/**
+ * Rule variants supported by GameLogic
+ *
+ * Each variant is a policy class the search and evaluation are instantiated with, so its rules
+ * are compile-time constants in the hot loops. GameLogic dispatches on its RuleVariant once per
+ * public call. Black is the side moving first, HUMAN_COLOR.
+ */
+enum RuleVariant {
+  // five or more in a row wins
+  FREESTYLE_RULES,
+  // exactly five in a row wins, for both sides
+  EXACT_FIVE_RULES,
+  // black wins with exactly five and may not play a double three, double four or overline,
+  // white wins with five or more
+  RENJU_RULES
+};
+
+
+struct FreestyleRules {
+  static const RuleVariant VARIANT = FREESTYLE_RULES;
+  static const bool HAS_FORBIDDEN = false;
+
+  /**
+   * Whether a run of length stones wins for its side
+   */
+  static inline bool IsWin(short length, bool /*isBlack*/){
+    return length >= 5;
+  }
+};
+
+
+struct ExactFiveRules {
+  static const RuleVariant VARIANT = EXACT_FIVE_RULES;
+  static const bool HAS_FORBIDDEN = false;
+
+  static inline bool IsWin(short length, bool /*isBlack*/){
+    return length == 5;
+  }
+};
+
+
+struct RenjuRules {
+  static const RuleVariant VARIANT = RENJU_RULES;
+  // black moves making a double three, a double four or an overline are forbidden
+  static const bool HAS_FORBIDDEN = true;
+
+  static inline bool IsWin(short length, bool isBlack){
+    return isBlack ? length == 5 : length >= 5;
+  }
+};
+
+#endif
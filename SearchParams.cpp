@@ -0,0 +1,25 @@
+#include "SearchParams.h"
+
+
+/**
+ * Constructor
+ */
+SearchParams::SearchParams()
+{
+  lateMoveReductions = true;
+  lmrMoves = 4;
+  lmrReduction = 1;
+
+  nullMove = true;
+  nullMoveReduction = 2;
+
+  futility = true;
+  futilityMargin = 150;
+
+  quiescence = true;
+  quiescenceDepth = 6;
+  quiescenceNodes = 24;
+
+  threatProof = true;
+  proofNodes = 20000;
+}
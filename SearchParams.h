@@ -0,0 +1,56 @@
+#ifndef SEARCH_PARAMS_H
+#define SEARCH_PARAMS_H
+
+/**
+ * Selective search settings of the minimax in GameLogic::assessMove
+ * Every technique can be switched off on its own, see tools/SearchBench.cpp for their effect.
+ * They are all on by default, so difficulty 2 does not play the moves of the plain minimax; switch
+ * them all off for its exact play
+ */
+struct SearchParams
+{
+  SearchParams();
+
+  /**
+   * Late-move reductions: quiet children after the first lmrMoves of the move ordering are searched
+   * lmrReduction plies shallower, and again at full depth only if they improve the best score
+   */
+  bool lateMoveReductions;
+  short lmrMoves;
+  short lmrReduction;
+
+  /**
+   * Null-move pruning: when neither side has a four or an open three on the board, let the side to
+   * move pass and search nullMoveReduction plies shallower. If the opponent still cannot do better
+   * than the parent's bound, the node is cut. Gomoku has no zugzwang, so passing is never better
+   * than moving
+   */
+  bool nullMove;
+  short nullMoveReduction;
+
+  /**
+   * Futility pruning: one ply above the leaves, quiet children are skipped when the static score
+   * plus futilityMargin cannot improve on the best child found so far
+   */
+  bool futility;
+  int futilityMargin;
+
+  /**
+   * Quiescence search: a leaf where either side has a four or an open three on the board is not
+   * scored as is. Only forcing moves (threats and the squares that answer them) are searched below
+   * it until the position is quiet, at most quiescenceDepth plies and quiescenceNodes positions per
+   * leaf. A four has to be answered, against a three the side to move may keep the static score
+   */
+  bool quiescence;
+  short quiescenceDepth;
+  short quiescenceNodes;
+
+  /**
+   * Threat-space proof: before searching, a proof-number search over the AI's fours looks for a
+   * forced win, see ProofSolver::SolveThreats. It gives up after proofNodes positions
+   */
+  bool threatProof;
+  unsigned int proofNodes;
+};
+
+#endif
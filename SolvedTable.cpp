@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <fstream>
+#include <new>
+#include <string.h>
+#include "SolvedTable.h"
+
+using namespace std;
+
+#define SOLVED_MAGIC    "C5PS"
+#define SOLVED_VERSION  1
+#define NO_MOVE         0xFFFF
+
+
+/**
+ * Constructor
+ */
+SolvedTable::SolvedTable()
+{
+  Reset(0, FREESTYLE_RULES);
+}
+
+
+void SolvedTable::Reset(short _dim, RuleVariant _rules){
+  dimSize = _dim;
+  rules = _rules;
+  keys.clear();
+  records.clear();
+  sorted = true;
+}
+
+
+bool SolvedTable::Load(const char* path){
+  ifstream in(path, ios::binary);
+  if (!in)
+    return false;
+
+  char magic[4];
+  uint32_t header[4];
+  in.read(magic, 4);
+  in.read((char*)header, sizeof(header));
+  if (!in || memcmp(magic, SOLVED_MAGIC, 4) != 0 || header[0] != SOLVED_VERSION)
+    return false;
+  if (header[1] == 0 || header[1] > 255 || header[2] > RENJU_RULES)
+    return false;
+
+  // the count must match the rest of the file before anything is allocated for it
+  streamoff begin = in.tellg();
+  in.seekg(0, ios::end);
+  streamoff size = in.tellg() - begin;
+  in.seekg(begin);
+  if (!in || (uint64_t)size != (uint64_t)header[3]*(sizeof(uint64_t) + sizeof(uint32_t)))
+    return false;
+
+  vector<uint64_t> _keys;
+  vector<uint32_t> _records;
+  try {
+    _keys.resize(header[3]);
+    _records.resize(header[3]);
+  } catch (const bad_alloc&){
+    return false;
+  }
+  in.read((char*)_keys.data(), _keys.size()*sizeof(uint64_t));
+  in.read((char*)_records.data(), _records.size()*sizeof(uint32_t));
+  if (!in)
+    return false;
+  for (size_t k=1; k<_keys.size(); k++){
+    if (_keys[k-1] >= _keys[k])
+      return false;
+  }
+
+  uint32_t numCells = header[1]*header[1];
+  for (size_t k=0; k<_records.size(); k++){
+    uint32_t move = _records[k] & 0xFFFF;
+    if ((move != NO_MOVE && move >= numCells) || ((_records[k] >> 16) & 0xFF) > PROOF_DRAW)
+      return false;
+  }
+
+  Reset((short)header[1], (RuleVariant)header[2]);
+  keys.swap(_keys);
+  records.swap(_records);
+  return true;
+}
+
+
+bool SolvedTable::Save(const char* path){
+  sort();
+
+  ofstream out(path, ios::binary);
+  if (!out)
+    return false;
+
+  uint32_t header[4] = {SOLVED_VERSION, (uint32_t)dimSize, (uint32_t)rules, (uint32_t)keys.size()};
+  out.write(SOLVED_MAGIC, 4);
+  out.write((const char*)header, sizeof(header));
+  out.write((const char*)keys.data(), keys.size()*sizeof(uint64_t));
+  out.write((const char*)records.data(), records.size()*sizeof(uint32_t));
+  return (bool)out;
+}
+
+
+void SolvedTable::Add(uint64_t key, const ProofOutcome& outcome){
+  keys.push_back(key);
+  records.push_back(pack(outcome));
+  sorted = false;
+}
+
+
+bool SolvedTable::Lookup(uint64_t key, ProofOutcome* outcome){
+  sort();
+
+  vector<uint64_t>::iterator it = lower_bound(keys.begin(), keys.end(), key);
+  if (it == keys.end() || *it != key)
+    return false;
+
+  (*outcome) = unpack(records[it - keys.begin()]);
+  return true;
+}
+
+
+/**
+ * Sort by key, the outcome added last winning among equal keys
+ */
+void SolvedTable::sort(){
+  if (sorted)
+    return;
+
+  vector<size_t> order(keys.size());
+  for (size_t k=0; k<order.size(); k++)
+    order[k] = k;
+  vector<uint64_t>& _keys = keys;
+  stable_sort(order.begin(), order.end(), [&_keys](size_t a, size_t b){
+    return _keys[a] < _keys[b];
+  });
+
+  vector<uint64_t> sortedKeys;
+  vector<uint32_t> sortedRecords;
+  for (size_t k=0; k<order.size(); k++){
+    if (!sortedKeys.empty() && sortedKeys.back() == keys[order[k]])
+      sortedRecords.back() = records[order[k]];
+    else {
+      sortedKeys.push_back(keys[order[k]]);
+      sortedRecords.push_back(records[order[k]]);
+    }
+  }
+
+  keys.swap(sortedKeys);
+  records.swap(sortedRecords);
+  sorted = true;
+}
+
+
+int SolvedTable::GetSize(){
+  sort();
+  return (int)keys.size();
+}
+
+
+short SolvedTable::GetDimSize(){
+  return dimSize;
+}
+
+
+RuleVariant SolvedTable::GetRules(){
+  return rules;
+}
+
+
+/**
+ * move in the low 16 bits, then the result and the distance capped to 255
+ */
+uint32_t SolvedTable::pack(const ProofOutcome& outcome){
+  uint32_t move = (outcome.row < 0) ? NO_MOVE : (uint32_t)(outcome.row*dimSize + outcome.col);
+  uint32_t distance = (uint32_t)min((short)255, max((short)0, outcome.distance));
+  return move | ((uint32_t)outcome.result << 16) | (distance << 24);
+}
+
+
+ProofOutcome SolvedTable::unpack(uint32_t record){
+  ProofOutcome outcome;
+  uint32_t move = record & 0xFFFF;
+
+  outcome.result = (ProofResult)((record >> 16) & 0xFF);
+  outcome.distance = (short)(record >> 24);
+  outcome.row = (move == NO_MOVE) ? -1 : (short)(move / dimSize);
+  outcome.col = (move == NO_MOVE) ? -1 : (short)(move % dimSize);
+  return outcome;
+}
@@ -0,0 +1,65 @@
+#ifndef SOLVED_TABLE_H
+#define SOLVED_TABLE_H
+
+#include <stdint.h>
+#include <vector>
+#include "ProofSolver.h"
+#include "RuleVariants.h"
+
+/**
+ * Solved positions of one board size and rule variant, keyed by ProofSolver::PositionKey
+ *
+ * Every position takes 12 bytes: the keys are kept sorted in one array and the packed results in
+ * another, so a lookup is a binary search and the file is loaded as is.
+ * Tables are built by tools/SolveTable.cpp
+ */
+class SolvedTable
+{
+public:
+  SolvedTable();
+
+  /**
+   * Empty the table and make it hold positions of a _dim board under _rules
+   */
+  void Reset(short _dim, RuleVariant _rules);
+
+  /**
+   * Layout (little endian):
+   *   char[4] magic, uint32 version, uint32 dimSize, uint32 rules, uint32 count,
+   *   uint64 keys[count] in increasing order, uint32 records[count]
+   * A record packs the move (row*dimSize+col, 0xFFFF for none), the ProofResult and the distance
+   * Return false if the file is missing or malformed: its size disagrees with count, or a record
+   * holds a move off the board or an unknown result
+   */
+  bool Load(const char* path);
+  bool Save(const char* path);
+
+  /**
+   * Add a solved position, replacing an earlier outcome of the same key
+   */
+  void Add(uint64_t key, const ProofOutcome& outcome);
+
+  /**
+   * Return false if the position is not in the table
+   */
+  bool Lookup(uint64_t key, ProofOutcome* outcome);
+
+  int GetSize();
+  short GetDimSize();
+  RuleVariant GetRules();
+
+private:
+  short dimSize;
+  RuleVariant rules;
+
+  std::vector<uint64_t> keys;
+  std::vector<uint32_t> records;
+  // Add appends, the arrays are sorted again before the next lookup or save
+  bool sorted;
+  void sort();
+
+  uint32_t pack(const ProofOutcome& outcome);
+  ProofOutcome unpack(uint32_t record);
+};
+
+#endif
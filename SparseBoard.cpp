@@ -0,0 +1,175 @@
+#include <string.h>
+#include "SparseBoard.h"
+#include "GameLogic.h"
+
+using namespace std;
+
+
+/**
+ * Constructor
+ */
+SparseBoard::SparseBoard(short _dim)
+{
+  dimSize = _dim;
+  cachedKey = 0;
+  cachedTile = nullptr;
+}
+
+
+/**
+ * Destructor
+ */
+SparseBoard::~SparseBoard()
+{
+  Clear();
+}
+
+
+bool SparseBoard::OnBoard(int row, int col){
+  if (dimSize == 0)
+    return row >= -LIMIT && row <= LIMIT && col >= -LIMIT && col <= LIMIT;
+
+  return row >= 0 && row < dimSize && col >= 0 && col < dimSize;
+}
+
+
+/**
+ * Tiles are keyed by their tile row and column, 16 bits each
+ * The arithmetic shift rounds negative coordinates down
+ */
+int SparseBoard::tileKey(short row, short col){
+  return (((row >> TILE_SHIFT) & 0xFFFF) << 16) | ((col >> TILE_SHIFT) & 0xFFFF);
+}
+
+
+int SparseBoard::cellOffset(short row, short col){
+  return (row & (TILE_SIZE-1))*TILE_SIZE + (col & (TILE_SIZE-1));
+}
+
+
+SparseBoard::Tile* SparseBoard::findTile(short row, short col, bool create){
+  int key = tileKey(row, col);
+  if (cachedTile != nullptr && cachedKey == key)
+    return cachedTile;
+
+  unordered_map<int, Tile*>::iterator it = tiles.find(key);
+  Tile* tile = nullptr;
+  if (it != tiles.end()){
+    tile = it->second;
+  } else if (create){
+    tile = new Tile;
+    memset(tile->cells, UNOCCUPIED, sizeof(tile->cells));
+    tile->count = 0;
+    tiles[key] = tile;
+  }
+
+  if (tile != nullptr){
+    cachedKey = key;
+    cachedTile = tile;
+  }
+  return tile;
+}
+
+
+char SparseBoard::Get(short row, short col){
+  Tile* tile = findTile(row, col, false);
+  if (tile == nullptr)
+    return UNOCCUPIED;
+
+  return tile->cells[cellOffset(row, col)];
+}
+
+
+/**
+ * Place side, or UNOCCUPIED to remove a stone
+ */
+void SparseBoard::Set(short row, short col, char side){
+  Tile* tile = findTile(row, col, side != UNOCCUPIED);
+  if (tile == nullptr)
+    return;
+
+  int offset = cellOffset(row, col);
+  char previous = tile->cells[offset];
+  tile->cells[offset] = side;
+
+  if (previous == UNOCCUPIED && side != UNOCCUPIED){
+    // new stone
+    SparseStone stone;
+    stone.row = row;
+    stone.col = col;
+    stone.side = side;
+    tile->slots[offset] = (int)stones.size();
+    tile->count++;
+    stones.push_back(stone);
+
+  } else if (previous != UNOCCUPIED && side == UNOCCUPIED){
+    // removed stone, the last stone of the list takes its slot
+    int slot = tile->slots[offset];
+    SparseStone last = stones.back();
+    stones[slot] = last;
+    stones.pop_back();
+    if (slot < (int)stones.size())
+      findTile(last.row, last.col, false)->slots[cellOffset(last.row, last.col)] = slot;
+
+    tile->count--;
+    if (tile->count == 0){
+      tiles.erase(tileKey(row, col));
+      delete tile;
+      cachedTile = nullptr;
+    }
+
+  } else if (previous != UNOCCUPIED){
+    // recolored stone
+    stones[tile->slots[offset]].side = side;
+  }
+}
+
+
+/**
+ * Write side, or UNOCCUPIED, at an empty cell, leaving the stone list and the tiles as they are
+ */
+void SparseBoard::Probe(short row, short col, char side){
+  Tile* tile = findTile(row, col, side != UNOCCUPIED);
+  if (tile != nullptr)
+    tile->cells[cellOffset(row, col)] = side;
+}
+
+
+void SparseBoard::Clear(){
+  for (unordered_map<int, Tile*>::iterator it=tiles.begin(); it!=tiles.end(); it++)
+    delete it->second;
+
+  tiles.clear();
+  stones.clear();
+  cachedTile = nullptr;
+}
+
+
+int SparseBoard::GetNumStones(){
+  return (int)stones.size();
+}
+
+
+SparseStone SparseBoard::GetStone(int k){
+  return stones[k];
+}
+
+
+/**
+ * Bounding box of the stones, false if there are none
+ */
+bool SparseBoard::GetBounds(short* minRow, short* minCol, short* maxRow, short* maxCol){
+  if (stones.empty())
+    return false;
+
+  (*minRow) = (*maxRow) = stones[0].row;
+  (*minCol) = (*maxCol) = stones[0].col;
+  for (size_t k=1; k<stones.size(); k++){
+    if (stones[k].row < *minRow) (*minRow) = stones[k].row;
+    if (stones[k].row > *maxRow) (*maxRow) = stones[k].row;
+    if (stones[k].col < *minCol) (*minCol) = stones[k].col;
+    if (stones[k].col > *maxCol) (*maxCol) = stones[k].col;
+  }
+
+  return true;
+}
@@ -0,0 +1,81 @@
+#ifndef SPARSE_BOARD_H
+#define SPARSE_BOARD_H
+
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A stone on a SparseBoard
+ */
+struct SparseStone {
+  short row, col;
+  char side;
+};
+
+
+/**
+ * Board storage for very large or unbounded boards
+ *
+ * Cells live in 16x16 tiles that are allocated when their first stone is placed and freed with
+ * their last one, so memory is bounded by the number of stones rather than the board area.
+ * The stones are also kept in a list, letting evaluation and move generation visit them directly
+ * instead of scanning the board.
+ */
+class SparseBoard
+{
+public:
+  /**
+   * _dim = 0 for an unbounded board, coordinates then range over [-LIMIT, LIMIT]
+   */
+  SparseBoard(short _dim);
+  ~SparseBoard();
+
+  static const short LIMIT = 16000;
+
+  bool OnBoard(int row, int col);
+
+  char Get(short row, short col);
+  /**
+   * Place side, or UNOCCUPIED to remove a stone
+   */
+  void Set(short row, short col, char side);
+  /**
+   * Write side, or UNOCCUPIED, at an empty cell for a probe that is undone before the stones are
+   * listed again. The stone list is left as is, and a tile allocated for the probe is kept
+   */
+  void Probe(short row, short col, char side);
+  void Clear();
+
+  int GetNumStones();
+  SparseStone GetStone(int k);
+
+  /**
+   * Bounding box of the stones, false if there are none
+   */
+  bool GetBounds(short* minRow, short* minCol, short* maxRow, short* maxCol);
+
+private:
+  static const short TILE_SHIFT = 4;
+  static const short TILE_SIZE = 1 << TILE_SHIFT;
+
+  struct Tile {
+    char cells[TILE_SIZE*TILE_SIZE];
+    // index of each stone in stones
+    int slots[TILE_SIZE*TILE_SIZE];
+    short count;
+  };
+
+  short dimSize;
+  std::unordered_map<int, Tile*> tiles;
+  std::vector<SparseStone> stones;
+
+  // last tile looked up, most accesses walk along a line within one tile
+  int cachedKey;
+  Tile* cachedTile;
+
+  Tile* findTile(short row, short col, bool create);
+  int tileKey(short row, short col);
+  int cellOffset(short row, short col);
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "Trace.h"
+
+#ifdef CONNECTFIVE_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+struct TraceEvent {
+  const char* name;
+  int64_t start;
+  int64_t end;
+};
+
+
+/**
+ * Ring buffer of one thread
+ * Buffers are never freed: when its thread exits, a buffer is handed to the next new thread,
+ * so threads created for every search do not accumulate buffers
+ */
+struct TraceBuffer {
+  TraceEvent* events;
+  // spans ever recorded, the last TRACE_BUFFER_EVENTS of them are kept
+  atomic<uint64_t> count;
+  // thread id in the export
+  int id;
+  bool inUse;
+};
+
+
+/**
+ * Every buffer
+ */
+struct TraceRegistry {
+  mutex lock;
+  vector<TraceBuffer*> buffers;
+};
+
+TraceRegistry& registry(){
+  static TraceRegistry instance;
+  return instance;
+}
+
+
+/**
+ * Takes a buffer for the calling thread on its first span and gives it back when the thread exits
+ */
+struct ThreadBuffer {
+  TraceBuffer* buffer;
+
+  ThreadBuffer(){
+    TraceRegistry& r = registry();
+    lock_guard<mutex> guard(r.lock);
+
+    buffer = nullptr;
+    for (size_t k=0; k<r.buffers.size() && buffer == nullptr; k++){
+      if (!r.buffers[k]->inUse)
+        buffer = r.buffers[k];
+    }
+    if (buffer == nullptr){
+      buffer = new TraceBuffer;
+      buffer->events = new TraceEvent[TRACE_BUFFER_EVENTS];
+      buffer->count = 0;
+      buffer->id = (int)r.buffers.size() + 1;
+      r.buffers.push_back(buffer);
+    }
+    buffer->inUse = true;
+  }
+
+  ~ThreadBuffer(){
+    lock_guard<mutex> guard(registry().lock);
+    buffer->inUse = false;
+  }
+};
+
+thread_local ThreadBuffer threadBuffer;
+
+}
+
+
+int64_t Trace::Now(){
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ * Append a span to the calling thread's buffer, overwriting its oldest span once full
+ */
+void Trace::Record(const char* name, int64_t start, int64_t end){
+  TraceBuffer* buffer = threadBuffer.buffer;
+  uint64_t n = buffer->count.load(memory_order_relaxed);
+
+  TraceEvent& e = buffer->events[n % TRACE_BUFFER_EVENTS];
+  e.name = name;
+  e.start = start;
+  e.end = end;
+  buffer->count.store(n+1, memory_order_release);
+}
+
+
+/**
+ * Complete ("X") events in microseconds from the start of the session, one track per thread buffer
+ */
+void Trace::WriteJSON(ostream& out, int64_t sessionStart){
+  TraceRegistry& r = registry();
+  lock_guard<mutex> guard(r.lock);
+  bool first = true;
+
+  // microseconds to the nanosecond, however long the session
+  ios::fmtflags flags = out.flags();
+  streamsize precision = out.precision();
+  out << fixed << setprecision(3);
+
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  for (size_t k=0; k<r.buffers.size(); k++){
+    TraceBuffer* buffer = r.buffers[k];
+    uint64_t count = buffer->count.load(memory_order_acquire);
+    uint64_t oldest = (count > TRACE_BUFFER_EVENTS) ? count - TRACE_BUFFER_EVENTS : 0;
+
+    for (uint64_t n=oldest; n<count; n++){
+      const TraceEvent& e = buffer->events[n % TRACE_BUFFER_EVENTS];
+      if (e.start < sessionStart)
+        continue;
+
+      out << (first ? "\n" : ",\n");
+      out << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+          << ",\"ts\":" << (e.start - sessionStart)/1000.0 << ",\"dur\":" << (e.end - e.start)/1000.0 << "}";
+      first = false;
+    }
+  }
+  out << "\n]}\n";
+  out.flags(flags);
+  out.precision(precision);
+}
+
+
+bool Trace::Export(const char* path, int64_t sessionStart){
+  ofstream out(path);
+  if (!out)
+    return false;
+
+  WriteJSON(out, sessionStart);
+  return (bool)out;
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * Opt-in latency tracing
+ *
+ * C5_TRACE_SCOPE("name") records a span covering the rest of the enclosing block. Spans go into a
+ * ring buffer owned by the recording thread, keeping the last TRACE_BUFFER_EVENTS spans of each
+ * thread, and are exported in the Chrome trace-event format (chrome://tracing, Perfetto).
+ *
+ * Tracing only exists when CONNECTFIVE_TRACE is defined: otherwise the macros expand to nothing
+ * and nothing is compiled in. A session is the spans begun since a start time its owner keeps.
+ * Spans are not tagged with their engine and the buffers are process-wide, so a session exported
+ * while several engines search also holds the spans of the others. Export only once the traced
+ * threads are idle.
+ */
+
+#ifdef CONNECTFIVE_TRACE
+
+#include <stdint.h>
+#include <ostream>
+
+#ifndef TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS  (1 << 18)
+#endif
+
+class Trace
+{
+public:
+  /**
+   * Monotonic time in nanoseconds
+   */
+  static int64_t Now();
+
+  /**
+   * Append a span to the calling thread's buffer
+   * name must outlive the export, in practice a string literal
+   */
+  static void Record(const char* name, int64_t start, int64_t end);
+
+  /**
+   * Write the spans begun since sessionStart, a Now() value, from every thread as Chrome
+   * trace-event JSON
+   * Return false if path cannot be written
+   */
+  static bool Export(const char* path, int64_t sessionStart);
+  static void WriteJSON(std::ostream& out, int64_t sessionStart);
+};
+
+
+/**
+ * Records a span from its construction to its destruction
+ */
+class TraceScope
+{
+public:
+  TraceScope(const char* _name) : name(_name), start(Trace::Now()) {}
+  ~TraceScope() { Trace::Record(name, start, Trace::Now()); }
+
+private:
+  const char* name;
+  int64_t start;
+};
+
+#define C5_TRACE_JOIN(a, b)         a##b
+#define C5_TRACE_NAME(a, b)         C5_TRACE_JOIN(a, b)
+#define C5_TRACE_SCOPE(name)        TraceScope C5_TRACE_NAME(traceScope, __LINE__)(name)
+
+#else
+
+#define C5_TRACE_SCOPE(name)
+
+#endif
+
+#endif
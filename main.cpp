@@ -5,12 +5,22 @@
 
 using namespace std;
 
+// pattern weights read at startup if present, see tools/TuneEval.cpp
+#define EVAL_PARAMS_FILE  "evalparams.txt"
+// traces of the AI moves, trace-1.json, trace-2.json ... when built with CONNECTFIVE_TRACE
+#define TRACE_FILE_PREFIX "trace"
+// solved positions read at the start of a game if present, solved<board size>.c5ps, see tools/SolveTable.cpp
+#define SOLVED_TABLE_PREFIX "solved"
+#define PRINT_TOTAL_NODES
+
 
 /**
  * Print main menu
  * Quit: 0
  * New game: 1
  * Set board: 2
+ * Set difficulty: 3
+ * Set rules: 4
  */
 short MainMenu(){
   while (1){
@@ -18,6 +28,7 @@ short MainMenu(){
     cout << "1. New game\n";
     cout << "2. Set board size\n";
     cout << "3. Set difficulty\n";
+    cout << "4. Set rules\n";
     cout << "q. Quit\n";
     cout << "\nChoice: ";
 
@@ -32,6 +43,8 @@ short MainMenu(){
       return 2;
     else if (a=="3")
       return 3;
+    else if (a=="4")
+      return 4;
   }
 }
 
@@ -44,8 +57,8 @@ short PromptBoard(){
   const short SMALLEST_SIZE = 6;
 
   do {
-    cout << endl << "Dimension size (min " << SMALLEST_SIZE+1 << "): ";
-  } while (!(cin >> ret) || ret <= SMALLEST_SIZE);
+    cout << endl << "Dimension size (min " << SMALLEST_SIZE+1 << ", " << UNBOUNDED_SIZE << " = unbounded): ";
+  } while (!(cin >> ret) || (ret <= SMALLEST_SIZE && ret != UNBOUNDED_SIZE));
 
   return ret;
 }
@@ -58,13 +71,31 @@ short PromptDifficulty(){
   short ret = 0;
 
   do {
-    cout << endl << "Set AI difficulty (1=easy, 2=hard): ";
-  } while (!(cin >> ret) || (ret < 1 || ret > 2));
+    cout << endl << "Set AI difficulty (1=easy, 2=hard, 3=Monte Carlo): ";
+  } while (!(cin >> ret) || (ret < 1 || ret > 3));
 
   return ret;
 }
 
 
+/**
+ * Set rule variant
+ */
+RuleVariant PromptRules(){
+  short ret = 0;
+
+  do {
+    cout << endl << "Set rules (1=freestyle, 2=exact five, 3=Renju, you play black): ";
+  } while (!(cin >> ret) || (ret < 1 || ret > 3));
+
+  if (ret == 2)
+    return EXACT_FIVE_RULES;
+  else if (ret == 3)
+    return RENJU_RULES;
+  return FREESTYLE_RULES;
+}
+
+
 /**
  * Return 1 on regular move
  * Return -1 on failure
@@ -91,11 +122,21 @@ short ReadMove(short *row, short *col){
 }
 
 
-int main(){
+/**
+ * Usage: ConnectFive [neural weight file]
+ */
+int main(int argc, char* argv[]){
   // board size;
   short dimSize = 15;
   // AI difficulty, 0 - 3
   short difficulty = 2;
+  // rule variant
+  RuleVariant rules = FREESTYLE_RULES;
+  // optional neural evaluator weights
+  const char* weightsPath = (argc > 1) ? argv[1] : nullptr;
+  // pattern weights, defaults unless EVAL_PARAMS_FILE is present
+  EvalParams params;
+  params.Load(EVAL_PARAMS_FILE);
 
   //- outside loop for overall game control
   while (1){
@@ -114,17 +155,27 @@ int main(){
       // choose difficulty
       difficulty = PromptDifficulty();
 
+    } else if (res == 4){
+      // choose rules
+      rules = PromptRules();
+
     } else {
 
       // play game
       GameLogic game(dimSize, difficulty);
+      game.SetRules(rules);
+      game.SetEvalParams(params);
+      game.SetTraceFile(TRACE_FILE_PREFIX);
+      game.LoadSolvedTable((SOLVED_TABLE_PREFIX + to_string(dimSize) + ".c5ps").c_str());
+      if (weightsPath != nullptr && !game.LoadNeuralWeights(weightsPath))
+        cout << endl << "Could not load " << weightsPath << " for this board size, using the default evaluator" << endl;
 
       //- inner loop for game play
       while (1){
         string in;
 
         // print board
-        game.PrintBoard();
+        game.PrintBoard(cout);
 
         // get human's move
         short row = -1, col = -1;
@@ -138,26 +189,36 @@ int main(){
         // determine winning condition
         GameLogic::Arbitration state = game.Arbitrate(HUMAN_COLOR);
         if (state==GameLogic::WIN){
-          game.PrintBoard();
+          game.PrintBoard(cout);
           cout << endl << "You've won!" << endl;
           goto END_MAIN_MENU;
         } else if (state == GameLogic::DRAW){
-          game.PrintBoard();
+          game.PrintBoard(cout);
           cout << endl << "Game is a draw." << endl;
           goto END_MAIN_MENU;
         }
 
         // AI's turn
-        game.AIMakeMove(&row, &col);
+        if (!game.AIMakeMove(&row, &col)){
+          game.PrintBoard(cout);
+          cout << endl << "Game is a draw." << endl;
+          goto END_MAIN_MENU;
+        }
+#ifdef PRINT_TOTAL_NODES
+        if (game.GetPlayoutCount() > 0)
+          cout << "Total playouts: " << game.GetPlayoutCount() << ", tree nodes: " << game.GetTreeNodeCount() << endl;
+        else if (difficulty > 1)
+          cout << "Total nodes traversed: " << game.GetNodeCount() << endl;
+#endif
 
         // determine winning condition
         state = game.Arbitrate(AI_COLOR);
         if (state==GameLogic::WIN){
-          game.PrintBoard();
+          game.PrintBoard(cout);
           cout << endl << "You lost!" << endl;
           goto END_MAIN_MENU;
         } else if (state == GameLogic::DRAW){
-          game.PrintBoard();
+          game.PrintBoard(cout);
           cout << endl << "Game is a draw." << endl;
           goto END_MAIN_MENU;
         }
@@ -0,0 +1,94 @@
+/**
+ * Selective search benchmark
+ *
+ * Usage: SearchBench [time budget ms per position, default 2000]
+ *
+ * For a few middle game positions, deepens the minimax one ply at a time until the time budget
+ * runs out, with every selective search technique off, with the pruning techniques only, and with
+ * the defaults of SearchParams (pruning and quiescence). Reports the deepest completed depth, its
+ * move and its node count.
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "../GameLogic.h"
+#include "../SearchParams.h"
+
+using namespace std;
+
+struct BenchPosition {
+  const char* name;
+  short dim;
+  // stones as row, col pairs, alternating human and AI, terminated by -1
+  short stones[64];
+};
+
+const BenchPosition POSITIONS[] = {
+  {"opening",  15, {7,7, 6,6, 7,8, 7,6, 8,8, -1}},
+  {"middle",   15, {7,7, 6,6, 7,8, 7,6, 8,8, 6,8, 9,9, 6,7, 5,5, 10,10, 4,4, 6,5, -1}},
+  {"crowded",  15, {7,7, 7,8, 8,7, 6,8, 8,8, 8,6, 6,6, 5,5, 9,9, 10,10, 9,7, 10,7, 6,7, 5,7, 8,9, 7,10, -1}},
+  {"large",    19, {9,9, 9,10, 10,10, 8,8, 10,9, 11,8, 10,11, 10,12, 9,11, -1}},
+};
+
+
+/**
+ * Deepen until the budget is used, return the deepest completed depth
+ */
+short Deepen(const BenchPosition& pos, const SearchParams& params, int budgetMs, short* row, short* col, unsigned int* nodes){
+  GameLogic game(pos.dim, 2);
+  game.SetSearchParams(params);
+
+  string cells(pos.dim*pos.dim, '.');
+  for (short k=0; pos.stones[2*k] >= 0; k++)
+    cells[pos.stones[2*k]*pos.dim + pos.stones[2*k+1]] = (k%2 == 0) ? HUMAN_COLOR : AI_COLOR;
+  game.SetPosition(cells.c_str());
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  short reached = 0;
+
+  for (short depth=1; ; depth++){
+    int elapsed = (int)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    short r, c;
+    if (elapsed >= budgetMs || !game.SearchBestMove(depth, budgetMs-elapsed, &r, &c))
+      break;
+
+    reached = depth;
+    (*row) = r;
+    (*col) = c;
+    (*nodes) = game.GetNodeCount();
+  }
+
+  return reached;
+}
+
+
+int main(int argc, char* argv[]){
+  int budgetMs = (argc > 1) ? atoi(argv[1]) : 2000;
+
+  SearchParams full;
+  full.lateMoveReductions = false;
+  full.nullMove = false;
+  full.futility = false;
+  full.quiescence = false;
+  SearchParams selective;
+  selective.quiescence = false;
+  SearchParams quiescence;
+
+  cout << "time budget " << budgetMs << " ms per position" << endl;
+  for (size_t p=0; p<sizeof(POSITIONS)/sizeof(POSITIONS[0]); p++){
+    const SearchParams* configs[3] = {&full, &selective, &quiescence};
+    const char* names[3] = {"full width", "selective", "quiescence"};
+
+    for (short k=0; k<3; k++){
+      short row = -1, col = -1;
+      unsigned int nodes = 0;
+      short depth = Deepen(POSITIONS[p], *configs[k], budgetMs, &row, &col, &nodes);
+
+      cout << POSITIONS[p].name << " " << names[k] << ": depth " << depth
+           << ", move " << row << "," << col << ", leaf nodes " << nodes << endl;
+    }
+  }
+
+  return 0;
+}
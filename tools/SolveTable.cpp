@@ -0,0 +1,177 @@
+/**
+ * Builder of the solved position tables read by GameLogic::LoadSolvedTable
+ *
+ * Usage: SolveTable <dim> <output table> [--rules freestyle|exact] [--games N] [--nodes N]
+ *                   [--table-bits N] [--seed N] [--merge table]
+ *
+ * Plays games of random moves next to the stones on a dim board, and solves every position met
+ * along the way with ProofSolver, for the side to move, within --nodes positions each. Solved
+ * positions are written to the table, unsolved ones are left to the search. --merge starts
+ * from an existing table of the same board size and rules.
+ */
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../GameLogic.h"
+#include "../ProofSolver.h"
+#include "../SolvedTable.h"
+
+using namespace std;
+
+
+/**
+ * Whether side playing [row, col] makes a five under rules
+ */
+bool MakesFive(const vector<char>& board, short dim, short row, short col, char side, RuleVariant rules){
+  const short DIRECTIONS[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+  for (short d=0; d<4; d++){
+    short length = 1;
+    for (short s=-1; s<=1; s+=2){
+      short r = row + s*DIRECTIONS[d][0], c = col + s*DIRECTIONS[d][1];
+      while (r >= 0 && r < dim && c >= 0 && c < dim && board[r*dim+c] == side){
+        length++;
+        r += s*DIRECTIONS[d][0];
+        c += s*DIRECTIONS[d][1];
+      }
+    }
+    if (rules == EXACT_FIVE_RULES ? length == 5 : length >= 5)
+      return true;
+  }
+  return false;
+}
+
+
+/**
+ * A random empty cell at most two cells from a stone, anywhere on an empty board
+ */
+short RandomMove(const vector<char>& board, short dim){
+  vector<short> cells;
+  bool empty = true;
+  for (short ind=0; ind<dim*dim; ind++){
+    if (board[ind] != UNOCCUPIED){
+      empty = false;
+      continue;
+    }
+
+    short row = ind / dim, col = ind % dim;
+    bool near = false;
+    for (short r=max(0, row-2); r<=min(dim-1, row+2) && !near; r++){
+      for (short c=max(0, col-2); c<=min(dim-1, col+2) && !near; c++)
+        near = (board[r*dim+c] != UNOCCUPIED);
+    }
+    if (near)
+      cells.push_back(ind);
+  }
+
+  if (empty)
+    return rand() % (dim*dim);
+  if (cells.empty())
+    return -1;
+  return cells[rand() % cells.size()];
+}
+
+
+int main(int argc, char* argv[]){
+  if (argc < 3){
+    cerr << "Usage: SolveTable <dim> <output table> [--rules freestyle|exact] [--games N] [--nodes N]" << endl
+         << "                  [--table-bits N] [--seed N] [--merge table]" << endl;
+    return 1;
+  }
+
+  short dim = (short)atoi(argv[1]);
+  const char* outputPath = argv[2];
+  RuleVariant rules = FREESTYLE_RULES;
+  int games = 100;
+  unsigned int maxNodes = 1000000;
+  short tableBits = 22;
+  unsigned int seed = 1;
+  const char* mergePath = nullptr;
+
+  for (int k=3; k<argc; k++){
+    string arg = argv[k];
+    if (arg == "--rules" && k+1 < argc){
+      string name = argv[++k];
+      if (name != "freestyle" && name != "exact"){
+        cerr << "Rules must be freestyle or exact, Renju is not solved" << endl;
+        return 1;
+      }
+      rules = (name == "exact") ? EXACT_FIVE_RULES : FREESTYLE_RULES;
+    } else if (arg == "--games" && k+1 < argc)
+      games = atoi(argv[++k]);
+    else if (arg == "--nodes" && k+1 < argc)
+      maxNodes = (unsigned int)atoi(argv[++k]);
+    else if (arg == "--table-bits" && k+1 < argc)
+      tableBits = (short)atoi(argv[++k]);
+    else if (arg == "--seed" && k+1 < argc)
+      seed = (unsigned int)atoi(argv[++k]);
+    else if (arg == "--merge" && k+1 < argc)
+      mergePath = argv[++k];
+    else {
+      cerr << "Unknown option " << arg << endl;
+      return 1;
+    }
+  }
+
+  if (dim < 5 || dim > MAX_DENSE_SIZE){
+    cerr << "Board size must be between 5 and " << MAX_DENSE_SIZE << endl;
+    return 1;
+  }
+
+  SolvedTable table;
+  table.Reset(dim, rules);
+  if (mergePath != nullptr){
+    if (!table.Load(mergePath) || table.GetDimSize() != dim || table.GetRules() != rules){
+      cerr << "Cannot merge " << mergePath << ": missing, or made for another board or rules" << endl;
+      return 1;
+    }
+  }
+
+  ProofSolver solver(dim, tableBits);
+  solver.SetRules(rules);
+  srand(seed);
+
+  unordered_set<uint64_t> tried;
+  int attempted = 0, solved = 0, counts[4] = {0, 0, 0, 0};
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  for (int g=0; g<games; g++){
+    vector<char> board(dim*dim, UNOCCUPIED);
+    char side = HUMAN_COLOR;
+
+    while (1){
+      uint64_t key = ProofSolver::PositionKey(board.data(), dim, side);
+      if (tried.insert(key).second){
+        ProofOutcome outcome = solver.Solve(board.data(), side, maxNodes);
+        attempted++;
+        counts[outcome.result]++;
+        if (outcome.result != PROOF_UNKNOWN){
+          table.Add(key, outcome);
+          solved++;
+        }
+      }
+
+      short move = RandomMove(board, dim);
+      if (move < 0 || MakesFive(board, dim, move / dim, move % dim, side, rules))
+        break;
+      board[move] = side;
+      side = (side == AI_COLOR) ? HUMAN_COLOR : AI_COLOR;
+    }
+
+    cout << "game " << g+1 << ": " << attempted << " positions, " << solved << " solved" << endl;
+  }
+
+  int elapsed = (int)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+  cout << "wins " << counts[PROOF_WIN] << ", losses " << counts[PROOF_LOSS] << ", draws " << counts[PROOF_DRAW]
+       << ", unknown " << counts[PROOF_UNKNOWN] << " in " << elapsed << " ms" << endl;
+
+  if (!table.Save(outputPath)){
+    cerr << "Cannot write " << outputPath << endl;
+    return 1;
+  }
+  cout << table.GetSize() << " positions written to " << outputPath << endl;
+  return 0;
+}
@@ -0,0 +1,332 @@
+/**
+ * Texel-style tuner for the pattern weights in EvalParams
+ *
+ * Usage: TuneEval <positions> <output params> [--init params] [--threads N] [--iterations N]
+ *                 [--rate R] [--symmetric]
+ *
+ * Positions use the format written by tools/train_nnue.py selfplay:
+ * "<dim> <cells> <result>", result being the game outcome for the AI (1, 0.5 or 0).
+ *
+ * assessBoard is linear in the pattern weights, so every position is reduced once to its pattern
+ * counts (GameLogic::CountPatterns). The weights are then fitted by minimizing the logistic loss
+ * of sigmoid(scale*score) against the results, scale being fitted first on the initial weights.
+ * Counts are stored one array per pattern so the loss and gradient loops run over contiguous
+ * positions and vectorize, and positions are split across threads.
+ */
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../GameLogic.h"
+#include "../EvalParams.h"
+
+using namespace std;
+
+/**
+ * Labelled positions reduced to pattern counts, stored pattern-major
+ */
+struct TrainingSet {
+  size_t size;
+  vector<float> counts[EvalParams::NUM_PARAMS];
+  vector<float> results;
+};
+
+
+/**
+ * Read the positions file
+ */
+bool ReadPositions(const char* path, vector<short>* dims, vector<string>* cells, vector<float>* results){
+  ifstream in(path);
+  if (!in)
+    return false;
+
+  string line;
+  while (getline(in, line)){
+    stringstream ss(line);
+    short dim;
+    string c;
+    float r;
+    if ((ss >> dim >> c >> r) && dim > 0 && (int)c.size() == dim*dim){
+      dims->push_back(dim);
+      cells->push_back(c);
+      results->push_back(r);
+    }
+  }
+
+  return true;
+}
+
+
+/**
+ * Reduce positions [begin, end) to pattern counts
+ * valid is cleared for the positions GameLogic::SetPosition rejects
+ */
+void ExtractChunk(TrainingSet* set, const vector<short>* dims, const vector<string>* cells, vector<char>* valid,
+                  size_t begin, size_t end){
+  map<short, GameLogic*> games;
+  int counts[EvalParams::NUM_PARAMS];
+
+  for (size_t n=begin; n<end; n++){
+    short dim = (*dims)[n];
+    if (games.find(dim) == games.end())
+      games[dim] = new GameLogic(dim, 1);
+
+    GameLogic* game = games[dim];
+    if (!game->SetPosition((*cells)[n].c_str())){
+      (*valid)[n] = 0;
+      continue;
+    }
+    game->CountPatterns(counts);
+
+    for (short k=0; k<EvalParams::NUM_PARAMS; k++)
+      set->counts[k][n] = (float)counts[k];
+  }
+
+  for (map<short, GameLogic*>::iterator it=games.begin(); it!=games.end(); it++)
+    delete it->second;
+}
+
+
+/**
+ * Loss and gradient over positions [begin, end)
+ * grad is only filled when not null
+ */
+void EvaluateChunk(const TrainingSet* set, const double* weights, double scale, size_t begin, size_t end,
+                   double* loss, double* grad){
+  size_t len = end-begin;
+  vector<float> score(len, 0.0f);
+
+  for (short k=0; k<EvalParams::NUM_PARAMS; k++){
+    const float w = (float)weights[k];
+    const float* c = &set->counts[k][begin];
+    float* s = &score[0];
+    for (size_t n=0; n<len; n++)
+      s[n] += w*c[n];
+  }
+
+  // score becomes the residual prediction - result
+  double total = 0;
+  const float* y = &set->results[begin];
+  for (size_t n=0; n<len; n++){
+    double p = 1.0/(1.0 + exp(-scale*score[n]));
+    p = (p<1e-7) ? 1e-7 : ((p>1-1e-7) ? 1-1e-7 : p);
+    total -= y[n]*log(p) + (1-y[n])*log(1-p);
+    score[n] = (float)(p - y[n]);
+  }
+  *loss = total;
+
+  if (grad == nullptr)
+    return;
+
+  for (short k=0; k<EvalParams::NUM_PARAMS; k++){
+    const float* c = &set->counts[k][begin];
+    const float* r = &score[0];
+    double g = 0;
+    for (size_t n=0; n<len; n++)
+      g += r[n]*c[n];
+    grad[k] = g*scale;
+  }
+}
+
+
+/**
+ * Mean loss over the whole set, and its gradient if grad is not null
+ */
+double Evaluate(const TrainingSet& set, const double* weights, double scale, short numThreads, double* grad){
+  vector<thread> workers;
+  vector<double> losses(numThreads, 0.0);
+  vector<double> grads(numThreads*EvalParams::NUM_PARAMS, 0.0);
+
+  size_t chunk = (set.size + numThreads - 1)/numThreads;
+  for (short t=0; t<numThreads; t++){
+    size_t begin = t*chunk;
+    size_t end = (begin+chunk < set.size) ? begin+chunk : set.size;
+    if (begin >= end)
+      continue;
+    workers.push_back(thread(EvaluateChunk, &set, weights, scale, begin, end,
+                             &losses[t], (grad != nullptr) ? &grads[t*EvalParams::NUM_PARAMS] : nullptr));
+  }
+  for (size_t t=0; t<workers.size(); t++)
+    workers[t].join();
+
+  double loss = 0;
+  for (short t=0; t<numThreads; t++)
+    loss += losses[t];
+
+  if (grad != nullptr){
+    for (short k=0; k<EvalParams::NUM_PARAMS; k++){
+      grad[k] = 0;
+      for (short t=0; t<numThreads; t++)
+        grad[k] += grads[t*EvalParams::NUM_PARAMS+k];
+      grad[k] /= set.size;
+    }
+  }
+
+  return loss/set.size;
+}
+
+
+/**
+ * Fit the sigmoid scale for the given weights by ternary search on log10(scale)
+ */
+double FitScale(const TrainingSet& set, const double* weights, short numThreads){
+  double lo = -6, hi = 0;
+  for (short it=0; it<40; it++){
+    double a = lo + (hi-lo)/3, b = hi - (hi-lo)/3;
+    if (Evaluate(set, weights, pow(10.0, a), numThreads, nullptr) < Evaluate(set, weights, pow(10.0, b), numThreads, nullptr))
+      hi = b;
+    else
+      lo = a;
+  }
+  return pow(10.0, (lo+hi)/2);
+}
+
+
+int main(int argc, char* argv[]){
+  if (argc < 3){
+    cerr << "Usage: TuneEval <positions> <output params> [--init params] [--threads N] [--iterations N] [--rate R] [--symmetric]" << endl;
+    return 1;
+  }
+
+  const char* positionsPath = argv[1];
+  const char* outputPath = argv[2];
+  const char* initPath = nullptr;
+  short numThreads = (short)thread::hardware_concurrency();
+  int iterations = 2000;
+  double rate = 2.0;
+  bool symmetric = false;
+
+  for (int a=3; a<argc; a++){
+    string opt = argv[a];
+    if (opt == "--init" && a+1 < argc)
+      initPath = argv[++a];
+    else if (opt == "--threads" && a+1 < argc)
+      numThreads = (short)atoi(argv[++a]);
+    else if (opt == "--iterations" && a+1 < argc)
+      iterations = atoi(argv[++a]);
+    else if (opt == "--rate" && a+1 < argc)
+      rate = atof(argv[++a]);
+    else if (opt == "--symmetric")
+      symmetric = true;
+    else {
+      cerr << "Unknown option " << opt << endl;
+      return 1;
+    }
+  }
+  if (numThreads < 1)
+    numThreads = 1;
+
+  EvalParams params;
+  if (initPath != nullptr && !params.Load(initPath)){
+    cerr << "Could not read " << initPath << endl;
+    return 1;
+  }
+
+  // load and reduce the positions
+  vector<short> dims;
+  vector<string> cells;
+  TrainingSet set;
+  if (!ReadPositions(positionsPath, &dims, &cells, &set.results) || set.results.empty()){
+    cerr << "No positions read from " << positionsPath << endl;
+    return 1;
+  }
+
+  set.size = set.results.size();
+  for (short k=0; k<EvalParams::NUM_PARAMS; k++)
+    set.counts[k].resize(set.size);
+
+  vector<char> valid(set.size, 1);
+  vector<thread> workers;
+  size_t chunk = (set.size + numThreads - 1)/numThreads;
+  for (short t=0; t<numThreads; t++){
+    size_t begin = t*chunk;
+    size_t end = (begin+chunk < set.size) ? begin+chunk : set.size;
+    if (begin < end)
+      workers.push_back(thread(ExtractChunk, &set, &dims, &cells, &valid, begin, end));
+  }
+  for (size_t t=0; t<workers.size(); t++)
+    workers[t].join();
+  cells.clear();
+
+  // drop the malformed positions
+  size_t kept = 0;
+  for (size_t n=0; n<set.size; n++){
+    if (!valid[n])
+      continue;
+    for (short k=0; k<EvalParams::NUM_PARAMS; k++)
+      set.counts[k][kept] = set.counts[k][n];
+    set.results[kept++] = set.results[n];
+  }
+  if (kept < set.size)
+    cerr << set.size - kept << " malformed positions skipped" << endl;
+  if (kept == 0){
+    cerr << "No valid positions in " << positionsPath << endl;
+    return 1;
+  }
+  set.size = kept;
+  set.results.resize(kept);
+  for (short k=0; k<EvalParams::NUM_PARAMS; k++)
+    set.counts[k].resize(kept);
+
+  cout << set.size << " positions, " << numThreads << " threads" << endl;
+
+  // fit the scale on the starting weights, then the weights with Adam
+  double weights[EvalParams::NUM_PARAMS];
+  for (short k=0; k<EvalParams::NUM_PARAMS; k++)
+    weights[k] = params.Get(k);
+
+  const short half = EvalParams::NUM_PARAMS/2;
+  if (symmetric){
+    // human patterns occupy the first half of the table, AI patterns the second
+    for (short k=0; k<half; k++){
+      weights[half+k] = (weights[half+k] - weights[k])/2;
+      weights[k] = -weights[half+k];
+    }
+  }
+
+  double scale = FitScale(set, weights, numThreads);
+  cout << "scale " << scale << ", initial loss " << Evaluate(set, weights, scale, numThreads, nullptr) << endl;
+
+  const double BETA1 = 0.9, BETA2 = 0.999, EPSILON = 1e-12;
+  double grad[EvalParams::NUM_PARAMS];
+  double m[EvalParams::NUM_PARAMS] = {0}, v[EvalParams::NUM_PARAMS] = {0};
+
+  for (int it=1; it<=iterations; it++){
+    double loss = Evaluate(set, weights, scale, numThreads, grad);
+
+    // tied weights move by the combined gradient
+    if (symmetric){
+      for (short k=0; k<half; k++){
+        grad[half+k] -= grad[k];
+        grad[k] = -grad[half+k];
+      }
+    }
+
+    for (short k=0; k<EvalParams::NUM_PARAMS; k++){
+      m[k] = BETA1*m[k] + (1-BETA1)*grad[k];
+      v[k] = BETA2*v[k] + (1-BETA2)*grad[k]*grad[k];
+      double mHat = m[k]/(1-pow(BETA1, it));
+      double vHat = v[k]/(1-pow(BETA2, it));
+      weights[k] -= rate*mHat/(sqrt(vHat) + EPSILON);
+    }
+
+    if (it % 100 == 0)
+      cout << "iteration " << it << " loss " << loss << endl;
+  }
+
+  for (short k=0; k<EvalParams::NUM_PARAMS; k++)
+    params.Set(k, (int)floor(weights[k] + 0.5));
+
+  if (!params.Save(outputPath)){
+    cerr << "Could not write " << outputPath << endl;
+    return 1;
+  }
+
+  cout << "final loss " << Evaluate(set, weights, scale, numThreads, nullptr) << ", written to " << outputPath << endl;
+  return 0;
+}
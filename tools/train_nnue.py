@@ -0,0 +1,310 @@
+#!/usr/bin/env python3
+"""
+Trainer for the NeuralEvaluator weights used by ConnectFive
+
+  train_nnue.py selfplay --dim 15 --games 2000 --out positions.txt
+  train_nnue.py train --positions positions.txt --dim 15 --out weights.nnue
+
+Positions are stored one per line as "<dim> <cells> <result>", where cells lists the board
+row by row using '.', 'B' (human) and 'W' (AI), and result is the game outcome for the AI
+(1 = AI won, 0 = human won, 0.5 = draw).
+
+The network has one input per (cell, color), a clipped ReLU hidden layer and a single win
+logit output. It is trained with logistic loss on the game outcome and quantized to the
+layout read by NeuralEvaluator::Load. The engine adds the weights of the stones on the board into
+int16 accumulators, so every hidden unit is kept within |bias| + sum over cells of the larger
+color weight <= 32767 once quantized; Load rejects files that break this bound.
+
+  char[4] "C5NN", uint32 version, uint32 dim, uint32 hidden,
+  int16 featureBias[hidden], int16 featureWeights[2*dim*dim][hidden],
+  int8 outputWeights[hidden], int32 outputBias
+
+Requires Python 3 and numpy (pip install numpy).
+"""
+
+import argparse
+import random
+import struct
+import sys
+
+import numpy as np
+
+HUMAN_COLOR = 'B'
+AI_COLOR = 'W'
+EMPTY = '.'
+
+VERSION = 1
+ACTIVATION_SCALE = 127
+WEIGHT_SCALE = 64
+
+DIRECTIONS = ((0, 1), (1, 0), (1, 1), (1, -1))
+
+
+#
+# Self-play
+#
+
+def run_length(board, dim, row, col, dr, dc, side):
+    """Stones of side through (row, col) along (dr, dc), counting (row, col) itself"""
+    length = 1
+    for sign in (1, -1):
+        i, j = row + sign*dr, col + sign*dc
+        while 0 <= i < dim and 0 <= j < dim and board[i*dim+j] == side:
+            length += 1
+            i += sign*dr
+            j += sign*dc
+    return length
+
+
+def candidates(board, dim):
+    """Empty cells next to a stone, same rule as GameLogic::isMoveAdmissible"""
+    moves = []
+    for i in range(dim):
+        for j in range(dim):
+            if board[i*dim+j] != EMPTY:
+                continue
+            near = False
+            for a in range(max(0, i-1), min(dim, i+2)):
+                for b in range(max(0, j-1), min(dim, j+2)):
+                    if board[a*dim+b] != EMPTY:
+                        near = True
+            if near:
+                moves.append((i, j))
+    return moves
+
+
+def pick_move(board, dim, side, temperature):
+    """Win if possible, block if needed, otherwise sample by local run lengths"""
+    other = AI_COLOR if side == HUMAN_COLOR else HUMAN_COLOR
+    moves = candidates(board, dim)
+
+    weights = []
+    block = None
+    for (i, j) in moves:
+        own = [run_length(board, dim, i, j, dr, dc, side) for (dr, dc) in DIRECTIONS]
+        opp = [run_length(board, dim, i, j, dr, dc, other) for (dr, dc) in DIRECTIONS]
+        if max(own) >= 5:
+            return (i, j)
+        if max(opp) >= 5:
+            block = (i, j)
+        weights.append(sum(l*l for l in own) + 0.8*sum(l*l for l in opp))
+
+    if block is not None:
+        return block
+
+    w = np.array(weights, dtype=np.float64) / temperature
+    w = np.exp(w - w.max())
+    return moves[np.random.choice(len(moves), p=w/w.sum())]
+
+
+def play_game(dim, temperature):
+    """Return the list of positions and the result for the AI"""
+    board = [EMPTY]*(dim*dim)
+    positions = []
+
+    side = HUMAN_COLOR
+    centre = dim//2
+    row, col = centre + random.randint(-2, 2), centre + random.randint(-2, 2)
+
+    for ply in range(dim*dim):
+        board[row*dim+col] = side
+        positions.append(''.join(board))
+
+        if max(run_length(board, dim, row, col, dr, dc, side) for (dr, dc) in DIRECTIONS) >= 5:
+            return positions, 1.0 if side == AI_COLOR else 0.0
+
+        side = AI_COLOR if side == HUMAN_COLOR else HUMAN_COLOR
+        if ply+1 < dim*dim:
+            row, col = pick_move(board, dim, side, temperature)
+
+    return positions, 0.5
+
+
+def selfplay(args):
+    random.seed(args.seed)
+    np.random.seed(args.seed)
+
+    with open(args.out, 'w') as out:
+        for game in range(args.games):
+            positions, result = play_game(args.dim, args.temperature)
+            for cells in positions:
+                out.write('%d %s %g\n' % (args.dim, cells, result))
+            if (game+1) % 100 == 0:
+                print('%d games' % (game+1), file=sys.stderr)
+
+
+#
+# Training
+#
+
+def load_positions(path, dim):
+    rows = []
+    results = []
+    with open(path) as f:
+        for line in f:
+            parts = line.split()
+            if len(parts) != 3 or int(parts[0]) != dim or len(parts[1]) != dim*dim:
+                continue
+            rows.append(parts[1])
+            results.append(float(parts[2]))
+    return rows, np.array(results, dtype=np.float32)
+
+
+def features(rows, dim):
+    """Dense (N, 2*dim*dim) inputs, AI_COLOR features first as in NeuralEvaluator::featureRow"""
+    cells = np.array([list(r) for r in rows])
+    x = np.zeros((len(rows), 2*dim*dim), dtype=np.float32)
+    x[:, :dim*dim] = (cells == AI_COLOR)
+    x[:, dim*dim:] = (cells == HUMAN_COLOR)
+    return x
+
+
+def symmetries(rows, dim):
+    """The 8 board symmetries of each position"""
+    out = []
+    for r in rows:
+        grid = np.array(list(r)).reshape(dim, dim)
+        for k in range(4):
+            g = np.rot90(grid, k)
+            out.append(''.join(g.flatten()))
+            out.append(''.join(np.fliplr(g).flatten()))
+    return out
+
+
+def accumulator_reach(w1, b1, dim):
+    """Largest |pre-activation| of each hidden unit over all boards, a cell holding one stone at most"""
+    cells = dim*dim
+    return np.abs(b1) + np.maximum(np.abs(w1[:cells]), np.abs(w1[cells:])).sum(axis=0)
+
+
+def bound_accumulator(w1, b1, dim):
+    """Scale down the hidden units whose quantized accumulator could leave the int16 range"""
+    # each quantized weight and the bias may round up by half a unit
+    limit = (32767 - 0.5*(dim*dim + 1)) / ACTIVATION_SCALE
+    scale = np.minimum(1.0, limit / np.maximum(accumulator_reach(w1, b1, dim), 1e-12))
+    w1 *= scale.astype(w1.dtype)
+    b1 *= scale.astype(b1.dtype)
+
+
+def train(args):
+    rows, results = load_positions(args.positions, args.dim)
+    if not rows:
+        sys.exit('no positions for dim %d in %s' % (args.dim, args.positions))
+
+    if args.augment:
+        rows = symmetries(rows, args.dim)
+        results = np.repeat(results, 8)
+
+    x = features(rows, args.dim)
+    y = results
+    n, inputs = x.shape
+    print('%d positions, %d inputs, %d hidden' % (n, inputs, args.hidden), file=sys.stderr)
+
+    rng = np.random.default_rng(args.seed)
+    w1 = rng.normal(0, 0.05, (inputs, args.hidden)).astype(np.float32)
+    b1 = np.full(args.hidden, 0.1, dtype=np.float32)
+    w2 = rng.normal(0, 0.1, args.hidden).astype(np.float32)
+    b2 = np.float32(0)
+
+    params = [w1, b1, w2, np.array([b2])]
+    moments = [(np.zeros_like(p), np.zeros_like(p)) for p in params]
+    beta1, beta2, eps = 0.9, 0.999, 1e-8
+    step = 0
+
+    # the quantized layers cannot represent weights outside these ranges
+    w1_limit = 32767.0 / ACTIVATION_SCALE
+    w2_limit = 127.0 / WEIGHT_SCALE
+
+    for epoch in range(args.epochs):
+        order = rng.permutation(n)
+        total = 0.0
+
+        for start in range(0, n, args.batch):
+            idx = order[start:start+args.batch]
+            xb, yb = x[idx], y[idx]
+            w1, b1, w2, b2 = params
+
+            pre = xb @ w1 + b1
+            h = np.clip(pre, 0, 1)
+            logit = h @ w2 + b2[0]
+            p = 1/(1 + np.exp(-logit))
+            total += -np.sum(yb*np.log(p + 1e-7) + (1-yb)*np.log(1 - p + 1e-7))
+
+            # backprop of the mean logistic loss
+            d_logit = (p - yb) / len(idx)
+            d_w2 = h.T @ d_logit
+            d_b2 = np.array([d_logit.sum()])
+            d_h = np.outer(d_logit, w2) * ((pre > 0) & (pre < 1))
+            d_w1 = xb.T @ d_h
+            d_b1 = d_h.sum(axis=0)
+
+            step += 1
+            for p_, g, (m, v) in zip(params, (d_w1, d_b1, d_w2, d_b2), moments):
+                m[:] = beta1*m + (1-beta1)*g
+                v[:] = beta2*v + (1-beta2)*g*g
+                m_hat = m / (1 - beta1**step)
+                v_hat = v / (1 - beta2**step)
+                p_ -= args.lr * m_hat / (np.sqrt(v_hat) + eps)
+
+            np.clip(params[0], -w1_limit, w1_limit, out=params[0])
+            np.clip(params[2], -w2_limit, w2_limit, out=params[2])
+            bound_accumulator(params[0], params[1], args.dim)
+
+        print('epoch %d loss %.5f' % (epoch+1, total/n), file=sys.stderr)
+
+    write_weights(args.out, args.dim, params)
+
+
+def write_weights(path, dim, params):
+    w1, b1, w2, b2 = params
+    hidden = len(b1)
+
+    q_w1 = np.clip(np.round(w1*ACTIVATION_SCALE), -32767, 32767).astype('<i2')
+    q_b1 = np.clip(np.round(b1*ACTIVATION_SCALE), -32767, 32767).astype('<i2')
+    q_w2 = np.clip(np.round(w2*WEIGHT_SCALE), -127, 127).astype('i1')
+    q_b2 = int(np.round(b2[0]*ACTIVATION_SCALE*WEIGHT_SCALE))
+
+    reach = accumulator_reach(q_w1.astype(np.int64), q_b1.astype(np.int64), dim)
+    if reach.max() > 32767:
+        sys.exit('hidden unit %d can overflow the accumulator' % int(reach.argmax()))
+
+    with open(path, 'wb') as out:
+        out.write(b'C5NN')
+        out.write(struct.pack('<III', VERSION, dim, hidden))
+        out.write(q_b1.tobytes())
+        out.write(q_w1.tobytes())
+        out.write(q_w2.tobytes())
+        out.write(struct.pack('<i', q_b2))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    sp = sub.add_parser('selfplay', help='generate labelled positions')
+    sp.add_argument('--dim', type=int, default=15)
+    sp.add_argument('--games', type=int, default=1000)
+    sp.add_argument('--temperature', type=float, default=4.0)
+    sp.add_argument('--seed', type=int, default=1)
+    sp.add_argument('--out', required=True)
+
+    tr = sub.add_parser('train', help='fit and quantize a network')
+    tr.add_argument('--positions', required=True)
+    tr.add_argument('--dim', type=int, default=15)
+    tr.add_argument('--hidden', type=int, default=64)
+    tr.add_argument('--epochs', type=int, default=10)
+    tr.add_argument('--batch', type=int, default=256)
+    tr.add_argument('--lr', type=float, default=1e-3)
+    tr.add_argument('--augment', action='store_true', help='train on all 8 board symmetries')
+    tr.add_argument('--seed', type=int, default=1)
+    tr.add_argument('--out', required=True)
+
+    args = parser.parse_args()
+    if args.command == 'train' and args.hidden % 16 != 0:
+        parser.error('--hidden must be a multiple of 16')
+
+    selfplay(args) if args.command == 'selfplay' else train(args)
+
+
+if __name__ == '__main__':
+    main()